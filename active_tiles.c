@@ -0,0 +1,281 @@
+/**
+ * @file active_tiles.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * in place sweeps that only update the tiles of the grid that still change
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * with a few local source points most of the grid settles long before the calculation is over, but a sweep
+ * still updates all of it. here the grid is split to square tiles, and the largest change of a cell in every
+ * tile is measured while it is updated. a tile is updated in the next sweep only if it, or one of its four
+ * neighbor tiles (wrapped, for a cyclic grid), changed at least by the threshold- so a quiet tile sleeps until
+ * a change next to it wakes it up.
+ * an in place sweep reads the cells it already updated, so a change also reaches the sleeping tiles after it in
+ * the same sweep- the tile right of it and the tile below it, and for a cyclic grid the last tile of its row
+ * (from the first tile) and the last tile of its column (from the first one, in the last row). such a tile is
+ * woken as soon as the tile before it changed by the threshold, in the sweep itself, and its skipped rows are
+ * exactly the ones that didn't read the change. so the cells a sleeping tile keeps are the ones it would get up
+ * to the changes below the threshold, and a threshold below every change gives exactly the cells of
+ * updateAllValues.
+ * the rows are swept in their regular order, only skipping the runs of the sleeping tiles, and the heat of the
+ * grid is summed in the order of the cells like in updateAllValues- the cells of a skipped run are only read.
+ * Input  : the grid and the tiles that are active
+ * Process: sweep the active tiles, measure their change, find the tiles of the next sweep
+ * Output : the heat of the grid after the sweep
+ */
+
+// ------------------------------ includes ------------------------------
+#include <string.h>
+#include "sweep.h"
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function lays out the active tiles of a grid in an arena
+ * @param tiles : the tiles to lay out
+ * @param arena : the arena
+ * @param threshold : the change a tile (or a neighbor tile) has to reach in a sweep to stay active
+ * @param tileSize : the number of rows and columns of a tile
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ */
+void layoutTileTracker(tile_tracker *tiles, calc_arena *arena, double threshold, unsigned int tileSize, size_t n,
+                       size_t m)
+{
+    tiles->threshold = threshold;
+    tiles->tileSize = tileSize > 0 ? tileSize : 1;
+    tiles->tileRows = (n + tiles->tileSize - 1) / tiles->tileSize;
+    tiles->tileCols = (m + tiles->tileSize - 1) / tiles->tileSize;
+    size_t count = tiles->tileRows * tiles->tileCols;
+    tiles->active = (unsigned char *) arenaAlloc(arena, count * sizeof(unsigned char));
+    tiles->loud = (unsigned char *) arenaAlloc(arena, count * sizeof(unsigned char));
+    tiles->change = (double *) arenaAlloc(arena, count * sizeof(double));
+    tiles->before = (double *) arenaAlloc(arena, tiles->tileSize * sizeof(double));
+}
+
+/**
+ * this function makes all the tiles active and zeroes their counts, for a new round
+ * @param tiles : the active tiles
+ */
+void resetTileTracker(tile_tracker *tiles)
+{
+    memset(tiles->active, 1, tiles->tileRows * tiles->tileCols * sizeof(unsigned char));
+    tiles->updated = 0;
+    tiles->skipped = 0;
+}
+
+/**
+ * this function updates a run of cells of an active tile in a row, and measures their largest change
+ * @param function : the function that calculates the new value of the cell
+ * @param rowCells : the first cell of the row in the strided grid
+ * @param stride : the distance between two rows of the grid
+ * @param m : the number of columns in the grid
+ * @param rowMask : the source mask of the row
+ * @param from : the first column of the run
+ * @param to : the column after the last one of the run
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @param omega : the relaxation factor (1 for plain Gauss-Seidel)
+ * @param tiles : the active tiles, with the buffer for the cells before the update
+ * @param heat : the heat sum of the sweep
+ * @return the largest change of a cell in the run (NaN if a cell is NaN)
+ */
+double updateTileRun(diff_func function, double *rowCells, size_t stride, size_t m, const unsigned char *rowMask,
+                     size_t from, size_t to, int isCyclic, double omega, tile_tracker *tiles, heat_sum *heat)
+{
+    memcpy(tiles->before, rowCells + from, (to - from) * sizeof(double));
+    if (isCyclic && from == 0 && m > 1)
+    { // the right halo gets the first cell after it is updated, like updateCyclicRow
+        updateRun(function, rowCells, stride, rowMask, 0, 1, omega, heat);
+        rowCells[m] = rowCells[0];
+        updateRun(function, rowCells, stride, rowMask, 1, to, omega, heat);
+    }
+    else
+    {
+        updateRun(function, rowCells, stride, rowMask, from, to, omega, heat);
+    }
+    double largest = 0;
+    size_t col;
+    for (col = from; col < to; ++col)
+    {
+        double change = fabs(rowCells[col] - tiles->before[col - from]);
+        if (!(change <= largest))
+        { // NaN stays
+            largest = change;
+        }
+    }
+    return largest;
+}
+
+/**
+ * this function tells if a tile changed at least by the threshold in the sweep (so far)
+ * @param tiles : the active tiles
+ * @param tile : the index of the tile
+ * @return 1 if it did and 0 otherwise (a sleeping tile didn't change)
+ */
+int isLoud(const tile_tracker *tiles, size_t tile)
+{
+    return tiles->active[tile] && !(tiles->change[tile] < tiles->threshold);
+}
+
+/**
+ * this function tells if a sleeping tile has to wake up in the row of the sweep- if a tile that the row reads
+ * already changed at least by the threshold in this sweep. those are the tile left of it and, in the first row
+ * of the tile, the tile above it; for a cyclic grid also the first tile of the row (for the last tile) and, in
+ * the last row of the grid, the tile of the first row.
+ * @param tiles : the active tiles
+ * @param row : the row of the sweep
+ * @param tileCol : the column of the tile
+ * @param n : the number of rows in the grid
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @return 1 if the tile has to wake up and 0 otherwise
+ */
+int isDisturbed(const tile_tracker *tiles, size_t row, size_t tileCol, size_t n, int isCyclic)
+{
+    size_t tileRow = row / tiles->tileSize, cols = tiles->tileCols, tile = tileRow * cols + tileCol;
+    if (tileCol > 0 && isLoud(tiles, tile - 1))
+    {
+        return 1;
+    }
+    if (row % tiles->tileSize == 0 && tileRow > 0 && isLoud(tiles, tile - cols))
+    {
+        return 1;
+    }
+    if (isCyclic && tileCol == cols - 1 && tileCol > 0 && isLoud(tiles, tile - tileCol))
+    { // the right halo is the first cell of the row, updated in this sweep
+        return 1;
+    }
+    // the bottom halo of the last row is the first row, updated in this sweep
+    return isCyclic && row == n - 1 && tileRow > 0 && isLoud(tiles, tileCol);
+}
+
+/**
+ * this function finds the tiles of the next sweep- the ones that changed at least by the threshold and their
+ * neighbor tiles- and counts the tiles of the last one
+ * @param tiles : the active tiles, after a sweep
+ * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic the neighbor tiles wrap
+ */
+void wakeTiles(tile_tracker *tiles, int isCyclic)
+{
+    size_t tileRow, tileCol, rows = tiles->tileRows, cols = tiles->tileCols;
+    for (tileRow = 0; tileRow < rows; ++tileRow)
+    {
+        for (tileCol = 0; tileCol < cols; ++tileCol)
+        {
+            size_t tile = tileRow * cols + tileCol;
+            if (tiles->active[tile])
+            {
+                ++tiles->updated;
+            }
+            else
+            {
+                ++tiles->skipped;
+            }
+            tiles->loud[tile] = (unsigned char) isLoud(tiles, tile);
+        }
+    }
+    for (tileRow = 0; tileRow < rows; ++tileRow)
+    {
+        for (tileCol = 0; tileCol < cols; ++tileCol)
+        {
+            const unsigned char *loud = tiles->loud + tileRow * cols;
+            int isActive = loud[tileCol];
+            if (tileCol > 0 || isCyclic)
+            {
+                isActive |= loud[tileCol > 0 ? tileCol - 1 : cols - 1];
+            }
+            if (tileCol + 1 < cols || isCyclic)
+            {
+                isActive |= loud[tileCol + 1 < cols ? tileCol + 1 : 0];
+            }
+            if (tileRow > 0 || isCyclic)
+            {
+                isActive |= tiles->loud[(tileRow > 0 ? tileRow - 1 : rows - 1) * cols + tileCol];
+            }
+            if (tileRow + 1 < rows || isCyclic)
+            {
+                isActive |= tiles->loud[(tileRow + 1 < rows ? tileRow + 1 : 0) * cols + tileCol];
+            }
+            tiles->active[tileRow * cols + tileCol] = (unsigned char) isActive;
+        }
+    }
+}
+
+/**
+ * this function runs an in place sweep on the active tiles of the grid. the rows go in their regular order
+ * and the halo of a cyclic grid is refreshed like in updateAllValues; the runs of the sleeping tiles are
+ * skipped, unless a change of this sweep reaches them (see isDisturbed).
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic the halo holds the wrapped neighbors
+ * @param sourceMask : the source mask filled by markSources
+ * @param omega : the relaxation factor (1 for plain Gauss-Seidel)
+ * @param tiles : the active tiles
+ * @return the sum of all the values in the grid after the update
+ */
+double updateActiveTiles(diff_func function, double *grid, size_t stride, size_t n, size_t m, int isCyclic,
+                         const unsigned char *sourceMask, double omega, tile_tracker *tiles)
+{
+    size_t row, col, tileCol, tileSize = tiles->tileSize;
+    heat_sum heat = {0, 0};
+    if (isCyclic)
+    { // the first row wraps to the last one before it is updated
+        memcpy(grid - stride, grid + (n - 1) * stride, m * sizeof(double));
+    }
+    for (row = 0; row < n; ++row)
+    {
+        size_t firstTile = row / tileSize * tiles->tileCols;
+        unsigned char *rowActive = tiles->active + firstTile;
+        double *rowCells = grid + row * stride;
+        if (isCyclic)
+        {
+            if (row == n - 1)
+            { // the last row wraps to the already updated first one
+                memcpy(grid + n * stride, grid, m * sizeof(double));
+            }
+            rowCells[-1] = rowCells[m - 1];
+            if (m == 1 || !rowActive[0])
+            { // otherwise the first cell is updated before it wraps
+                rowCells[m] = rowCells[0];
+            }
+        }
+        for (tileCol = 0; tileCol < tiles->tileCols; ++tileCol)
+        {
+            size_t tile = firstTile + tileCol, from = tileCol * tileSize;
+            size_t to = from + tileSize < m ? from + tileSize : m;
+            if (rowActive[tileCol] && row % tileSize == 0)
+            { // the first row of the tile
+                tiles->change[tile] = 0;
+            }
+            else if (!rowActive[tileCol] && isDisturbed(tiles, row, tileCol, n, isCyclic))
+            { // its rows above didn't read the change, so they stay skipped
+                rowActive[tileCol] = 1;
+                tiles->change[tile] = 0;
+            }
+            if (!rowActive[tileCol])
+            {
+                for (col = from; col < to; ++col)
+                {
+                    ADD_HEAT(heat.sum, heat.compensation, rowCells[col]);
+                }
+                continue;
+            }
+            double change = updateTileRun(function, rowCells, stride, m, sourceMask + row * m, from, to, isCyclic,
+                                          omega, tiles, &heat);
+            if (!(change <= tiles->change[tile]))
+            {
+                tiles->change[tile] = change;
+            }
+        }
+    }
+    wakeTiles(tiles, isCyclic);
+    return heat.sum + heat.compensation;
+}
@@ -0,0 +1,216 @@
+/**
+ * @file active_tiles_test.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * the tests of the active tiles- with a threshold below every change they must give the cells of a full sweep
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * a tile with no change sleeps even with the smallest threshold, so a threshold below every change still skips
+ * tiles, and the skipped tiles must be exactly the ones a full sweep wouldn't change. every case is calculated
+ * twice- with all the cells and with the active tiles- and the results and the cells of every round have to be
+ * the same bits. the cases are cyclic and not, with n_iter and until terminate, Gauss-Seidel and SOR, with the
+ * built-in heat equation and with another function, on tiles of many sizes.
+ * Input  : none
+ * Process: calculate every case with and without the active tiles and compare them
+ * Output : the failed cases, and the exit code 0 if all the cases passed
+ */
+
+// ------------------------------ includes ------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "calculator.h"
+#include "heat_eqn.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * the threshold below every change
+ */
+#define TINY_THRESHOLD 1e-300
+
+/**
+ * the number of random cases
+ */
+#define RANDOM_CASES 400
+
+/**
+ * the most source points of a random case
+ */
+#define MAX_SOURCES 6
+
+/**
+ * @brief a case of the tests
+ */
+typedef struct
+{
+    diff_func function;
+    size_t n, m;
+    source_point sources[MAX_SOURCES];
+    size_t num_sources;
+    double terminate;
+    unsigned int n_iter, rounds, tileSize;
+    int isCyclic;
+    iteration_scheme scheme;
+} tiles_case;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function is a function of the calculator other than the built-in heat equation- a weighted average that
+ * leans to the top neighbor
+ * @param right : the right neighbor
+ * @param top : the top neighbor
+ * @param left : the left neighbor
+ * @param bottom : the bottom neighbor
+ * @return the new value of the cell
+ */
+double leaningAverage(double right, double top, double left, double bottom)
+{
+    return (right + 2 * top + left + bottom) / 5;
+}
+
+/**
+ * this function allocates the grid of a case, with the values of its source points
+ * @param tilesCase : the case
+ * @param stride : a pointer for the distance between two rows of the grid
+ * @return the grid, or NULL if the allocation failed
+ */
+double *allocCaseGrid(const tiles_case *tilesCase, size_t *stride)
+{
+    double *grid = allocStridedGrid(tilesCase->n, tilesCase->m, stride);
+    size_t i;
+    for (i = 0; grid != NULL && i < tilesCase->num_sources; ++i)
+    {
+        grid[tilesCase->sources[i].x * *stride + tilesCase->sources[i].y] = tilesCase->sources[i].value;
+    }
+    return grid;
+}
+
+/**
+ * this function calculates a case with all the cells and with the active tiles, and compares every round
+ * @param name : the name of the case
+ * @param tilesCase : the case
+ * @param skipped : the number of tile updates skipped, to add to
+ * @return 1 if the case passed and 0 otherwise
+ */
+int checkCase(const char *name, const tiles_case *tilesCase, unsigned long *skipped)
+{
+    size_t stride, tilesStride, row;
+    double *grid = allocCaseGrid(tilesCase, &stride), *tilesGrid = allocCaseGrid(tilesCase, &tilesStride);
+    calc_options options, tilesOptions;
+    calc_stats stats;
+    memset(&stats, 0, sizeof(calc_stats));
+    initCalcOptions(&options);
+    options.scheme = tilesCase->scheme;
+    tilesOptions = options;
+    tilesOptions.tile_threshold = TINY_THRESHOLD;
+    tilesOptions.tile_size = tilesCase->tileSize;
+    tilesOptions.stats = &stats;
+    int isPassed = grid != NULL && tilesGrid != NULL;
+    unsigned int round;
+    for (round = 1; isPassed && round <= tilesCase->rounds; ++round)
+    {
+        double result = calculateWithOptions(tilesCase->function, grid, stride, tilesCase->n, tilesCase->m,
+                                             (source_point *) tilesCase->sources, tilesCase->num_sources,
+                                             tilesCase->terminate, tilesCase->n_iter, tilesCase->isCyclic,
+                                             &options);
+        double tilesResult = calculateWithOptions(tilesCase->function, tilesGrid, tilesStride, tilesCase->n,
+                                                  tilesCase->m, (source_point *) tilesCase->sources,
+                                                  tilesCase->num_sources, tilesCase->terminate, tilesCase->n_iter,
+                                                  tilesCase->isCyclic, &tilesOptions);
+        isPassed = memcmp(&result, &tilesResult, sizeof(double)) == 0;
+        for (row = 0; isPassed && row < tilesCase->n; ++row)
+        {
+            isPassed = memcmp(grid + row * stride, tilesGrid + row * tilesStride,
+                              tilesCase->m * sizeof(double)) == 0;
+        }
+        if (!isPassed)
+        {
+            printf("FAIL %s: %zux%zu %s, n_iter %u, tiles of %u- round %u gives %.9g with all the cells and %.9g "
+                   "with the active tiles\n", name, tilesCase->n, tilesCase->m,
+                   tilesCase->isCyclic ? "cyclic" : "not cyclic", tilesCase->n_iter, tilesCase->tileSize, round,
+                   result, tilesResult);
+        }
+    }
+    *skipped += stats.skipped_tiles;
+    freeCalcStats(&stats);
+    freeStridedGrid(grid, stride);
+    freeStridedGrid(tilesGrid, tilesStride);
+    return isPassed;
+}
+
+/**
+ * this function gives the next number of a xorshift generator, so the random cases are the same in every run
+ * @param state : the state of the generator (not zero)
+ * @param limit : the number of values
+ * @return a random number below limit
+ */
+size_t randomBelow(uint64_t *state, size_t limit)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return (size_t) (*state % limit);
+}
+
+/**
+ * this function makes a random case
+ * @param state : the state of the generator
+ * @param tilesCase : the case to fill
+ */
+void randomCase(uint64_t *state, tiles_case *tilesCase)
+{
+    static const unsigned int ITERATIONS[] = {0, 1, 3, 20};
+    size_t i;
+    tilesCase->function = randomBelow(state, 4) == 0 ? leaningAverage : heat_eqn;
+    tilesCase->n = 1 + randomBelow(state, 30);
+    tilesCase->m = 1 + randomBelow(state, 30);
+    tilesCase->num_sources = 1 + randomBelow(state, MAX_SOURCES);
+    for (i = 0; i < tilesCase->num_sources; ++i)
+    {
+        tilesCase->sources[i].x = (int) randomBelow(state, tilesCase->n);
+        tilesCase->sources[i].y = (int) randomBelow(state, tilesCase->m);
+        tilesCase->sources[i].value = ((double) randomBelow(state, 2001) - 500) / 8;
+    }
+    tilesCase->terminate = randomBelow(state, 2) ? 1e-2 : 1e-3;
+    tilesCase->n_iter = ITERATIONS[randomBelow(state, 4)];
+    tilesCase->rounds = 1 + (unsigned int) randomBelow(state, 3);
+    tilesCase->tileSize = 1 + (unsigned int) randomBelow(state, 8);
+    tilesCase->isCyclic = (int) randomBelow(state, 2);
+    tilesCase->scheme = randomBelow(state, 3) == 0 ? SOR : GAUSS_SEIDEL;
+}
+
+/**
+ * this function runs the tests of the active tiles
+ * @return 0 if all the cases passed and 1 otherwise
+ */
+int main(void)
+{
+    // a change that reaches sleeping tiles through the wrap of a cyclic grid in the same sweep
+    tiles_case wrapCase = {heat_eqn, 37, 11, {{17, 7, -5}, {32, 5, 2.5}, {28, 4, 5}}, 3, 1e-3, 3, 3, 4, 1,
+                           GAUSS_SEIDEL};
+    unsigned long cases = 1, failed = 0, skipped = 0;
+    failed += !checkCase("cyclic wrap", &wrapCase, &skipped);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    unsigned int i;
+    for (i = 0; i < RANDOM_CASES; ++i, ++cases)
+    {
+        tiles_case tilesCase;
+        randomCase(&state, &tilesCase);
+        failed += !checkCase("random", &tilesCase, &skipped);
+    }
+    if (skipped == 0)
+    { // the cases wouldn't test the skipping
+        printf("FAIL no tile update was skipped\n");
+        ++failed;
+    }
+    printf("active_tiles_test: %lu cases (%lu tile updates skipped), %lu failed\n", cases, skipped, failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file async_output.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * the writer thread of the output stage- writes the rounds while the next ones are calculated
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * the calculation copies every round to a snapshot buffer of a ring and goes on to the next round. a writer
+ * thread takes the snapshots out of the ring in their order and writes them with the grid_writer. the ring has a
+ * fixed number of buffers- when all of them wait to be written the calculation waits for the thread (the
+ * stall), so the memory of the output is bounded.
+ * the time the thread wrote, the time the calculation stalled and the time the last rounds took to drain give
+ * the part of the writing that overlapped the calculation.
+ * Input  : the rounds of a calculation
+ * Process: copy the rounds and write them on another thread
+ * Output : the rounds, in the format of the grid_writer
+ */
+
+// ------------------------------ includes ------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "output.h"
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function returns the time in seconds of a monotonic clock
+ * @return the time
+ */
+double currentSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+}
+
+/**
+ * this function is the writer thread- it writes the queued snapshots in their order until the writer closes
+ * @param arg : the async_writer
+ * @return NULL
+ */
+void *runAsyncWriter(void *arg)
+{
+    async_writer *async = (async_writer *) arg;
+    pthread_mutex_lock(&async->lock);
+    while (1)
+    {
+        while (async->count == 0 && !async->closing)
+        {
+            pthread_cond_wait(&async->changed, &async->lock);
+        }
+        if (async->count == 0)
+        { // closing, and everything was written
+            break;
+        }
+        size_t slot = async->head;
+        pthread_mutex_unlock(&async->lock);
+        // the snapshot is out of the reach of submitRound until it leaves the queue
+        double start = currentSeconds();
+        int status = async->failed ? 0 : writeRound(async->writer, async->cells + slot * async->n * async->m,
+                                                    async->m, async->n, async->m, async->results[slot]);
+        double seconds = currentSeconds() - start;
+        pthread_mutex_lock(&async->lock);
+        async->writeSeconds += seconds;
+        if (status != 0)
+        { // the rest of the rounds are dropped
+            async->failed = 1;
+        }
+        async->head = (async->head + 1) % async->depth;
+        --async->count;
+        pthread_cond_broadcast(&async->changed);
+    }
+    pthread_mutex_unlock(&async->lock);
+    return NULL;
+}
+
+/**
+ * this function opens a writer thread in front of the given writer
+ * @param async : the writer thread to open
+ * @param writer : the writer of the rounds
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param depth : the number of snapshot buffers
+ * @return 0 on success and -1 if the buffers or the thread couldn't be created
+ */
+int openAsyncWriter(async_writer *async, grid_writer *writer, size_t n, size_t m, size_t depth)
+{
+    memset(async, 0, sizeof(async_writer));
+    async->writer = writer;
+    async->n = n;
+    async->m = m;
+    async->depth = depth;
+    async->cells = (double *) malloc(depth * n * m * sizeof(double));
+    async->results = (double *) malloc(depth * sizeof(double));
+    if (async->cells == NULL || async->results == NULL)
+    {
+        free(async->cells);
+        free(async->results);
+        return -1;
+    }
+    pthread_mutex_init(&async->lock, NULL);
+    pthread_cond_init(&async->changed, NULL);
+    if (pthread_create(&async->thread, NULL, runAsyncWriter, async) != 0)
+    {
+        pthread_cond_destroy(&async->changed);
+        pthread_mutex_destroy(&async->lock);
+        free(async->cells);
+        free(async->results);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * this function copies a round to a free snapshot buffer and queues it for the writer thread
+ * @param async : the writer thread
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param result : the result of the calculate function
+ * @return 0 on success and -1 if writing an earlier round failed
+ */
+int submitRound(async_writer *async, const double *grid, size_t stride, double result)
+{
+    pthread_mutex_lock(&async->lock);
+    double start = currentSeconds();
+    while (async->count == async->depth && !async->failed)
+    { // all the buffers wait to be written
+        pthread_cond_wait(&async->changed, &async->lock);
+    }
+    async->stallSeconds += currentSeconds() - start;
+    if (async->failed)
+    {
+        pthread_mutex_unlock(&async->lock);
+        return -1;
+    }
+    size_t slot = (async->head + async->count) % async->depth;
+    pthread_mutex_unlock(&async->lock);
+    // the slot isn't queued, so the thread doesn't touch it
+    double *snapshot = async->cells + slot * async->n * async->m;
+    size_t row;
+    for (row = 0; row < async->n; ++row)
+    {
+        memcpy(snapshot + row * async->m, grid + row * stride, async->m * sizeof(double));
+    }
+    pthread_mutex_lock(&async->lock);
+    async->results[slot] = result;
+    ++async->count;
+    ++async->rounds;
+    pthread_cond_broadcast(&async->changed);
+    pthread_mutex_unlock(&async->lock);
+    return 0;
+}
+
+/**
+ * this function waits for the queued rounds to be written (as a stall of the calculation), so whatever was
+ * submitted is in the output
+ * @param async : the writer thread
+ * @return 0 on success and -1 if a write failed
+ */
+int drainAsyncWriter(async_writer *async)
+{
+    pthread_mutex_lock(&async->lock);
+    double start = currentSeconds();
+    while (async->count > 0)
+    {
+        pthread_cond_wait(&async->changed, &async->lock);
+    }
+    async->stallSeconds += currentSeconds() - start;
+    int status = async->failed ? -1 : 0;
+    pthread_mutex_unlock(&async->lock);
+    return status;
+}
+
+/**
+ * this function waits for the queued rounds to be written, stops the thread and frees the buffers
+ * @param async : the writer thread to close
+ * @return 0 on success and -1 if a write failed
+ */
+int closeAsyncWriter(async_writer *async)
+{
+    double start = currentSeconds();
+    pthread_mutex_lock(&async->lock);
+    async->closing = 1;
+    pthread_cond_broadcast(&async->changed);
+    pthread_mutex_unlock(&async->lock);
+    pthread_join(async->thread, NULL);
+    async->drainSeconds = currentSeconds() - start;
+    pthread_cond_destroy(&async->changed);
+    pthread_mutex_destroy(&async->lock);
+    free(async->cells);
+    free(async->results);
+    return async->failed ? -1 : 0;
+}
+
+/**
+ * this function prints the timing summary of a writer thread to stderr. the writing that didn't overlap the
+ * calculation is the time the rounds stalled and the time the last rounds drained.
+ * @param async : the closed writer thread
+ * @param solveSeconds : the time the calculation took
+ */
+void reportAsyncWriter(const async_writer *async, double solveSeconds)
+{
+    double exposed = async->stallSeconds + async->drainSeconds;
+    double overlap = async->writeSeconds > exposed ? (async->writeSeconds - exposed) / async->writeSeconds : 0;
+    fprintf(stderr, "rounds: %lu, solve: %.3lfs, write: %.3lfs, stalled: %.3lfs, drain: %.3lfs, overlap: %.1lf%%\n",
+            async->rounds, solveSeconds, async->writeSeconds, async->stallSeconds, async->drainSeconds,
+            overlap * 100);
+}
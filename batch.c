@@ -0,0 +1,449 @@
+/**
+ * @file batch.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * batch mode- many input files solved in one process by a pool of worker threads
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * a sweep of parameters runs thousands of small cases, and a process for every case pays its startup for a
+ * calculation that takes a few milliseconds, on a single cpu. here the cases are split to even ranges, one for
+ * every worker thread, and every worker solves its range from its front. a worker that finished its range steals
+ * the back half of the range of another worker- the cases don't take the same time, so the workers that got the
+ * quick ones help the others instead of waiting for them. the ranges are short and a case is long next to a
+ * lock, so every range has a lock of its own.
+ * every worker keeps a solver_context that it reuses from case to case, so a case allocates the memory of its
+ * calculation only when it needs more than all the cases before it.
+ * Input  : the list of the cases, and the function that solves a case
+ * Process: solve the cases on the workers, stealing between them
+ * Output : the output of every case, and the counts of the batch
+ */
+
+// ------------------------------ includes ------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "batch.h"
+#include "output.h"
+#include "tokenizer.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * the number of cases the list of the cases starts with (it doubles when it fills)
+ */
+#define INITIAL_CASES 64
+
+/**
+ * the comment sign of a manifest
+ */
+#define MANIFEST_COMMENT '#'
+
+/**
+ * @brief the cases a worker still has to solve- the cases [first, last) of the batch
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    size_t first, last;
+} case_range;
+
+struct batch_state;
+
+/**
+ * @brief a worker thread of the batch
+ */
+typedef struct
+{
+    struct batch_state *batch;
+    unsigned int index;
+    case_range range;
+    /** the solver the worker reuses between its cases */
+    solver_context *solver;
+    /** the counts of the worker */
+    unsigned long cases, failed, steals;
+} batch_worker;
+
+/**
+ * @brief the state shared by the workers of a batch
+ */
+typedef struct batch_state
+{
+    char **cases;
+    const char *outputDir;
+    case_solver solve;
+    void *context;
+    unsigned int numWorkers;
+    batch_worker *workers;
+} batch_state;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function adds a copy of a name to the list of the cases
+ * @param cases : the pointer for the list of the cases
+ * @param numCases : the pointer for the number of cases in the list
+ * @param capacity : the pointer for the number of cases the list has room for
+ * @param name : the name of the case
+ * @param length : the length of the name
+ * @return 0 on success and -1 if the memory couldn't be allocated
+ */
+int addCase(char ***cases, size_t *numCases, size_t *capacity, const char *name, size_t length)
+{
+    if (*numCases == *capacity)
+    {
+        size_t newCapacity = *capacity > 0 ? *capacity * 2 : INITIAL_CASES;
+        char **newCases = (char **) realloc(*cases, newCapacity * sizeof(char *));
+        if (newCases == NULL)
+        {
+            return -1;
+        }
+        *cases = newCases;
+        *capacity = newCapacity;
+    }
+    char *copy = (char *) malloc(length + 1);
+    if (copy == NULL)
+    {
+        return -1;
+    }
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+    (*cases)[(*numCases)++] = copy;
+    return 0;
+}
+
+/**
+ * this function compares two names of cases, for sorting them
+ * @param first : a pointer to the first name
+ * @param second : a pointer to the second name
+ * @return the order of the names, like strcmp
+ */
+int compareCases(const void *first, const void *second)
+{
+    return strcmp(*(char *const *) first, *(char *const *) second);
+}
+
+/**
+ * this function lists the regular files of a directory, by their path
+ * @param path : the path of the directory
+ * @param cases : the pointer for the list of the cases
+ * @param numCases : the pointer for the number of cases in the list
+ * @param capacity : the pointer for the number of cases the list has room for
+ * @return 0 on success and -1 if the directory couldn't be read or the memory couldn't be allocated
+ */
+int listDirectory(const char *path, char ***cases, size_t *numCases, size_t *capacity)
+{
+    DIR *directory = opendir(path);
+    if (directory == NULL)
+    {
+        return -1;
+    }
+    struct dirent *entry;
+    size_t pathLength = strlen(path);
+    int status = 0;
+    while (status == 0 && (entry = readdir(directory)) != NULL)
+    {
+        if (entry->d_name[0] == '.')
+        { // hidden files, and the directory and its parent
+            continue;
+        }
+        size_t length = pathLength + 1 + strlen(entry->d_name);
+        char *name = (char *) malloc(length + 1);
+        if (name == NULL)
+        {
+            status = -1;
+            break;
+        }
+        sprintf(name, "%s/%s", path, entry->d_name);
+        struct stat fileStatus;
+        if (stat(name, &fileStatus) == 0 && S_ISREG(fileStatus.st_mode))
+        {
+            status = addCase(cases, numCases, capacity, name, length);
+        }
+        free(name);
+    }
+    closedir(directory);
+    if (status == 0)
+    {
+        qsort(*cases, *numCases, sizeof(char *), compareCases);
+    }
+    return status;
+}
+
+/**
+ * this function lists the files of a manifest- one on every line, without the empty lines and the comments
+ * @param path : the path of the manifest
+ * @param cases : the pointer for the list of the cases
+ * @param numCases : the pointer for the number of cases in the list
+ * @param capacity : the pointer for the number of cases the list has room for
+ * @return 0 on success and -1 if the manifest couldn't be read or the memory couldn't be allocated
+ */
+int listManifest(const char *path, char ***cases, size_t *numCases, size_t *capacity)
+{
+    input_cursor input;
+    if (openInput(path, &input) != 0)
+    {
+        return -1;
+    }
+    const char *line;
+    size_t length;
+    int status = 0;
+    while (status == 0 && (length = readLinePrefix(&input, &line, (size_t) (input.end - input.pos))) > 0)
+    {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' || line[length - 1] == ' ' ||
+                              line[length - 1] == '\t'))
+        {
+            --length;
+        }
+        if (length > 0 && line[0] != MANIFEST_COMMENT)
+        {
+            status = addCase(cases, numCases, capacity, line, length);
+        }
+    }
+    closeInput(&input);
+    return status;
+}
+
+/**
+ * this function lists the cases of a batch- the files of a directory, or of a manifest
+ * @param path : the path of the directory or of the manifest
+ * @param numCases : the pointer for the number of cases
+ * @return the new list of the cases, or NULL if it couldn't be read (with numCases 0) or the memory couldn't be
+ * allocated
+ */
+char **listBatchCases(const char *path, size_t *numCases)
+{
+    char **cases = NULL;
+    size_t capacity = 0;
+    struct stat pathStatus;
+    *numCases = 0;
+    int status = stat(path, &pathStatus) == 0 && S_ISDIR(pathStatus.st_mode) ?
+                 listDirectory(path, &cases, numCases, &capacity) :
+                 listManifest(path, &cases, numCases, &capacity);
+    if (status != 0)
+    {
+        freeBatchCases(cases, *numCases);
+        *numCases = 0;
+        return NULL;
+    }
+    if (cases == NULL)
+    { // an empty list
+        cases = (char **) malloc(sizeof(char *));
+    }
+    return cases;
+}
+
+/**
+ * this function frees a list of cases
+ * @param cases : the list of the cases
+ * @param numCases : the number of cases
+ */
+void freeBatchCases(char **cases, size_t numCases)
+{
+    size_t i;
+    for (i = 0; i < numCases && cases != NULL; ++i)
+    {
+        free(cases[i]);
+    }
+    free(cases);
+}
+
+/**
+ * this function takes the next case of a worker, from the front of its range
+ * @param worker : the worker
+ * @param index : the pointer for the index of the case
+ * @return 1 if a case was taken and 0 if the range is empty
+ */
+int takeCase(batch_worker *worker, size_t *index)
+{
+    int isTaken = 0;
+    pthread_mutex_lock(&worker->range.lock);
+    if (worker->range.first < worker->range.last)
+    {
+        *index = worker->range.first++;
+        isTaken = 1;
+    }
+    pthread_mutex_unlock(&worker->range.lock);
+    return isTaken;
+}
+
+/**
+ * this function steals the back half of the range of the next worker that has cases left, to the (empty) range
+ * of the given worker
+ * @param worker : the worker
+ * @return 1 if cases were stolen and 0 if no worker has cases left
+ */
+int stealCases(batch_worker *worker)
+{
+    batch_state *batch = worker->batch;
+    unsigned int i;
+    for (i = 1; i < batch->numWorkers; ++i)
+    {
+        batch_worker *victim = &batch->workers[(worker->index + i) % batch->numWorkers];
+        size_t first = 0, last = 0;
+        pthread_mutex_lock(&victim->range.lock);
+        if (victim->range.first < victim->range.last)
+        { // the victim keeps the smaller half, it is already working on its front
+            last = victim->range.last;
+            first = last - (last - victim->range.first + 1) / 2;
+            victim->range.last = first;
+        }
+        pthread_mutex_unlock(&victim->range.lock);
+        if (first < last)
+        {
+            pthread_mutex_lock(&worker->range.lock);
+            worker->range.first = first;
+            worker->range.last = last;
+            pthread_mutex_unlock(&worker->range.lock);
+            ++worker->steals;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * this function solves a case of the batch, to its output file in the output directory
+ * @param worker : the worker that solves the case
+ * @param inputFile : the input file of the case
+ * @return 0 on success and -1 otherwise
+ */
+int solveCase(batch_worker *worker, const char *inputFile)
+{
+    batch_state *batch = worker->batch;
+    const char *slash = strrchr(inputFile, '/');
+    const char *name = slash != NULL ? slash + 1 : inputFile;
+    char *outputFile = (char *) malloc(strlen(batch->outputDir) + 1 + strlen(name) + sizeof(BATCH_OUTPUT_SUFFIX));
+    if (outputFile == NULL)
+    {
+        return -1;
+    }
+    sprintf(outputFile, "%s/%s%s", batch->outputDir, name, BATCH_OUTPUT_SUFFIX);
+    int status = batch->solve(inputFile, outputFile, worker->solver, batch->context);
+    free(outputFile);
+    return status;
+}
+
+/**
+ * this function is a worker thread- it solves the cases of its range and then steals more, until none are left
+ * @param arg : the batch_worker
+ * @return NULL
+ */
+void *runWorker(void *arg)
+{
+    batch_worker *worker = (batch_worker *) arg;
+    size_t index;
+    do
+    {
+        while (takeCase(worker, &index))
+        {
+            ++worker->cases;
+            if (solveCase(worker, worker->batch->cases[index]) != 0)
+            {
+                ++worker->failed;
+            }
+        }
+    } while (stealCases(worker));
+    return NULL;
+}
+
+/**
+ * this function solves all the cases of a batch on a pool of worker threads. the calling thread is the first
+ * worker; if not all the other ones start, the ranges of the ones that didn't are stolen by the ones that did.
+ * @param cases : the list of the input files
+ * @param numCases : the number of cases
+ * @param outputDir : the directory of the outputs (created if it doesn't exist)
+ * @param numWorkers : the number of worker threads, or 0 for the number of cpus
+ * @param solve : the function that solves a case
+ * @param context : the context of solve
+ * @param report : the report to fill with the counts of the batch
+ * @return 0 when the batch ran and -1 if the directory couldn't be created or the memory couldn't be allocated
+ */
+int runBatch(char **cases, size_t numCases, const char *outputDir, unsigned int numWorkers, case_solver solve,
+             void *context, batch_report *report)
+{
+    if (mkdir(outputDir, 0755) != 0 && errno != EEXIST)
+    {
+        return -1;
+    }
+    if (numWorkers == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numWorkers = cpus > 0 ? (unsigned int) cpus : 1;
+    }
+    if (numWorkers > numCases)
+    { // a worker without a case only steals
+        numWorkers = numCases > 0 ? (unsigned int) numCases : 1;
+    }
+    batch_state batch = {cases, outputDir, solve, context, numWorkers, NULL};
+    batch.workers = (batch_worker *) malloc(numWorkers * sizeof(batch_worker));
+    pthread_t *threads = (pthread_t *) malloc(numWorkers * sizeof(pthread_t));
+    if (batch.workers == NULL || threads == NULL)
+    {
+        free(batch.workers);
+        free(threads);
+        return -1;
+    }
+    double start = currentSeconds();
+    unsigned int i, started;
+    for (i = 0; i < numWorkers; ++i)
+    {
+        batch_worker *worker = &batch.workers[i];
+        worker->solver = createSolver();
+        if (worker->solver == NULL)
+        {
+            while (i-- > 0)
+            {
+                destroySolver(batch.workers[i].solver);
+                pthread_mutex_destroy(&batch.workers[i].range.lock);
+            }
+            free(batch.workers);
+            free(threads);
+            return -1;
+        }
+        worker->batch = &batch;
+        worker->index = i;
+        pthread_mutex_init(&worker->range.lock, NULL);
+        worker->range.first = numCases * i / numWorkers;
+        worker->range.last = numCases * (i + 1) / numWorkers;
+        worker->cases = 0;
+        worker->failed = 0;
+        worker->steals = 0;
+    }
+    for (started = 1; started < numWorkers; ++started)
+    {
+        if (pthread_create(&threads[started], NULL, runWorker, &batch.workers[started]) != 0)
+        {
+            break;
+        }
+    }
+    runWorker(&batch.workers[0]);
+    report->cases = 0;
+    report->failed = 0;
+    report->steals = 0;
+    for (i = 0; i < numWorkers; ++i)
+    {
+        if (i > 0 && i < started)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        report->cases += batch.workers[i].cases;
+        report->failed += batch.workers[i].failed;
+        report->steals += batch.workers[i].steals;
+        destroySolver(batch.workers[i].solver);
+        pthread_mutex_destroy(&batch.workers[i].range.lock);
+    }
+    report->seconds = currentSeconds() - start;
+    free(batch.workers);
+    free(threads);
+    return 0;
+}
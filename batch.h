@@ -0,0 +1,58 @@
+/*
+ * batch.h
+ *
+ * Solves many input files in one process- the cases of a batch are split between worker threads that steal
+ * from each other when they run out, and every case is written to an output of its own.
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdlib.h>
+#include "calculator.h"
+
+/**
+ * The suffix of the output of a case- the output of "dir/case.txt" is "<output dir>/case.txt.out".
+ */
+#define BATCH_OUTPUT_SUFFIX ".out"
+
+/**
+ * Solves a single case of a batch- the given input file, written to the given output file- with the given
+ * solver (the solver of the worker thread, reused from case to case). Returns 0 on success and -1 otherwise.
+ */
+typedef int (*case_solver)(const char *inputFile, const char *outputFile, solver_context *solver, void *context);
+
+/**
+ * The counts of a batch.
+ */
+typedef struct
+{
+    /** the number of cases solved (successfully or not) and of the ones that failed */
+    unsigned long cases, failed;
+    /** the number of times a worker stole cases from another one */
+    unsigned long steals;
+    /** the time the batch took in seconds */
+    double seconds;
+} batch_report;
+
+/**
+ * Lists the cases of a batch- the regular files in the given directory (sorted by name, without the hidden
+ * ones), or else the files in the given manifest (one per line; empty lines and lines starting with '#' are
+ * skipped). Returns a new list of new names, or NULL if the list couldn't be read (with numCases 0) or the
+ * memory couldn't be allocated.
+ */
+char **listBatchCases(const char *path, size_t *numCases);
+
+/**
+ * Frees a list of cases made by listBatchCases.
+ */
+void freeBatchCases(char **cases, size_t numCases);
+
+/**
+ * Solves all the cases with solve on numWorkers threads (0 for the number of cpus), writing their outputs to
+ * the given directory (created if it doesn't exist). Returns 0 when the batch ran (its report has the cases that
+ * failed) and -1 if the directory couldn't be created or the memory couldn't be allocated.
+ */
+int runBatch(char **cases, size_t numCases, const char *outputDir, unsigned int numWorkers, case_solver solve,
+             void *context, batch_report *report);
+
+#endif /* BATCH_H */
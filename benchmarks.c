@@ -0,0 +1,1195 @@
+/**
+ * @file benchmarks.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * the benchmarks of the calculator- how the cost of a sweep moves with the things the engines were built for
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * every benchmark prints a table. a measure runs the calculation again with twice the sweeps until it takes
+ * MIN_BENCH_SECONDS, so a fast case isn't lost in the noise of the clock. some benchmarks run the sweep the
+ * calculator had at first (the reference sweep- a scan of the source points and a mod for every neighbor of
+ * every cell) next to the engines; it only runs while it fits in REFERENCE_BUDGET cell updates.
+ * the largest grids take long on a small machine- --max-size=N caps every side of a grid at N.
+ * Input  : the names of the benchmarks to run (all of them if none is given) and --max-size=N
+ * Process: time the sweeps of every case
+ * Output : a table for every benchmark
+ */
+
+// ------------------------------ includes ------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "calculator.h"
+#include "heat_eqn.h"
+#include "sweep.h"
+#include "output.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * the shortest time a measure runs, in seconds
+ */
+#define MIN_BENCH_SECONDS 0.2
+
+/**
+ * the most cell updates (times the source points they scan) the reference sweep runs in a measure
+ */
+#define REFERENCE_BUDGET 4e9
+
+/**
+ * the side of the grids when no --max-size is given- the largest the benchmarks ask for
+ */
+#define DEFAULT_MAX_SIZE 8192
+
+/**
+ * the option that caps the side of the grids
+ */
+#define MAX_SIZE_OPTION "--max-size="
+
+/**
+ * the side of the grid of the source points benchmark, and the numbers of source points it runs
+ */
+#define SOURCES_GRID_SIZE 2048
+static const size_t SOURCE_COUNTS[] = {0, 10, 100, 1000, 10000, 100000};
+
+/**
+ * the sides of the grids of the sweep benchmark- the grid of input.txt and a large one- and the source points of
+ * input.txt, that are on every one of them
+ */
+static const size_t SWEEP_SIZES[] = {50, 4096};
+static const source_point INPUT_SOURCES[] = {{0, 0, 5}, {0, 1, 5}, {0, 2, 5}, {0, 47, -5}, {0, 48, -5},
+                                             {0, 49, -5}};
+
+/**
+ * the side of the grid of the stencil benchmark, the number of source points on it and the number of sweeps
+ * its cells are compared after
+ */
+#define STENCIL_GRID_SIZE 1024
+#define STENCIL_SOURCES 100
+#define STENCIL_CHECK_SWEEPS 10
+
+/**
+ * the side of the grid of the threads benchmark, and the numbers of threads it runs
+ */
+#define THREADS_GRID_SIZE 2048
+static const unsigned int THREAD_COUNTS[] = {1, 2, 4, 8, 16, 32};
+
+/**
+ * the sides of the grids of the multigrid benchmark go from MULTIGRID_FIRST_SIZE, doubling, to
+ * MULTIGRID_LAST_SIZE. the calculations run until the heat difference of a sweep (or of a V-cycle) is below
+ * MULTIGRID_TERMINATE, and Gauss-Seidel stops at MULTIGRID_BUDGET seconds- the larger grids are left to
+ * multigrid once it does. Gauss-Seidel checks the heat difference every MULTIGRID_CHECK_SWEEPS sweeps.
+ */
+#define MULTIGRID_FIRST_SIZE 64
+#define MULTIGRID_LAST_SIZE 8192
+#define MULTIGRID_TERMINATE 1e-4
+#define MULTIGRID_BUDGET 60
+#define MULTIGRID_CHECK_SWEEPS 16
+
+/**
+ * the side of the grid of the simd benchmark
+ */
+#define SIMD_GRID_SIZE 2048
+
+/**
+ * the side of the grid of the writer benchmark, and the side of the grid its text is compared on
+ */
+#define WRITER_GRID_SIZE 4000
+#define WRITER_CHECK_SIZE 200
+
+/**
+ * the file the writer benchmark writes to
+ */
+#define NULL_DEVICE "/dev/null"
+
+/**
+ * the sides of the grids of the warm start benchmark, the number of source points on them, the terminate of
+ * the calculations and how much the values of the source points move between the runs
+ */
+static const size_t WARM_SIZES[] = {64, 128, 256};
+#define WARM_SOURCES 10
+#define WARM_TERMINATE 1e-4
+#define WARM_PERTURBATION 1.05
+
+/**
+ * the sides of the grids of the block sweeps benchmark- one that fits in the cache and ones that don't- and the
+ * numbers of sweeps in a pass it runs
+ */
+static const size_t BLOCK_SIZES[] = {512, 3000, 4096};
+static const unsigned int BLOCK_SWEEPS[] = {1, 2, 4, 8, 32};
+
+/**
+ * @brief the limits every benchmark runs in
+ */
+typedef struct
+{
+    size_t maxSize;
+} bench_limits;
+
+/**
+ * @brief a benchmark- its name on the command line and the function that runs it
+ */
+typedef struct
+{
+    const char *name;
+    void (*run)(const bench_limits *limits);
+} benchmark;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function gives the time in seconds of a monotonic clock
+ * @return the time
+ */
+double benchSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+/**
+ * this function gives the next number of a xorshift generator, so the cases are the same in every run
+ * @param state : the state of the generator (not zero)
+ * @param limit : the number of values
+ * @return a random number below limit
+ */
+size_t randomBelow(uint64_t *state, size_t limit)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return (size_t) (*state % limit);
+}
+
+/**
+ * this function is the built-in heat equation behind a pointer the engines can't tell from heat_eqn, so they
+ * run their generic kernels and call it for every cell
+ * @param right : the right neighbor
+ * @param top : the top neighbor
+ * @param left : the left neighbor
+ * @param bottom : the bottom neighbor
+ * @return the new value of the cell
+ */
+double pointerHeatEqn(double right, double top, double left, double bottom)
+{
+    return heatEqnStencil(right, top, left, bottom);
+}
+
+/**
+ * this function caps the side of a grid
+ * @param size : the side the benchmark asks for
+ * @param limits : the limits of the benchmarks
+ * @return the side to run
+ */
+size_t capSize(size_t size, const bench_limits *limits)
+{
+    return size < limits->maxSize ? size : limits->maxSize;
+}
+
+/**
+ * this function makes random source points on a grid (some may fall on the same cell)
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param num_sources : the number of source points
+ * @return the source points, or NULL if the allocation failed
+ */
+source_point *randomSources(size_t n, size_t m, size_t num_sources)
+{
+    source_point *sources = (source_point *) malloc((num_sources > 0 ? num_sources : 1) * sizeof(source_point));
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    size_t i;
+    for (i = 0; sources != NULL && i < num_sources; ++i)
+    {
+        sources[i].x = (int) randomBelow(&state, n);
+        sources[i].y = (int) randomBelow(&state, m);
+        sources[i].value = (double) randomBelow(&state, 201) - 100;
+    }
+    return sources;
+}
+
+/**
+ * this function measures the sweeps of a calculation- it runs n_iter sweeps, twice as many every time, until
+ * they take MIN_BENCH_SECONDS
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @param options : the options of the calculation
+ * @return the seconds of a sweep, or a negative value if the memory couldn't be allocated
+ */
+double timeSweeps(diff_func function, double *grid, size_t stride, size_t n, size_t m, source_point *sources,
+                  size_t num_sources, int isCyclic, const calc_options *options)
+{
+    unsigned int sweeps = 1;
+    while (1)
+    {
+        double start = benchSeconds();
+        if (calculateWithOptions(function, grid, stride, n, m, sources, num_sources, 0, sweeps, isCyclic,
+                                 options) < 0)
+        {
+            return -1;
+        }
+        double seconds = benchSeconds() - start;
+        if (seconds >= MIN_BENCH_SECONDS || sweeps >= (1U << 30))
+        {
+            return seconds / sweeps;
+        }
+        sweeps *= 2;
+    }
+}
+
+/**
+ * this function gives the neighbor of a cell the way the reference sweep does- with a mod for a cyclic grid and
+ * zero off the board
+ * @param rows : the rows of the grid
+ * @param row : the row of the neighbor (may be off the board by one)
+ * @param col : the column of the neighbor (may be off the board by one)
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @return the value of the neighbor
+ */
+double referenceNeighbor(double **rows, int row, int col, size_t n, size_t m, int isCyclic)
+{
+    if (isCyclic)
+    {
+        row = (row % (int) n + (int) n) % (int) n;
+        col = (col % (int) m + (int) m) % (int) m;
+    }
+    if (row >= (int) n || row < 0 || col >= (int) m || col < 0)
+    {
+        return 0;
+    }
+    return rows[row][col];
+}
+
+/**
+ * this function tells if a cell is a source point the way the reference sweep does- by scanning all of them
+ * @param row : the row of the cell
+ * @param col : the column of the cell
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @return 1 if the cell is a source point and 0 otherwise
+ */
+int isReferenceSource(int row, int col, const source_point *sources, size_t num_sources)
+{
+    size_t i;
+    for (i = 0; i < num_sources; ++i)
+    {
+        if (sources[i].x == row && sources[i].y == col)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * this function runs a sweep the way the calculator did at first- every cell scans all the source points and
+ * finds its neighbors with referenceNeighbor
+ * @param function : the function that calculates the new value of the cell
+ * @param rows : the rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ */
+void referenceSweep(diff_func function, double **rows, size_t n, size_t m, int isCyclic,
+                    const source_point *sources, size_t num_sources)
+{
+    int row, col;
+    for (row = 0; row < (int) n; ++row)
+    {
+        for (col = 0; col < (int) m; ++col)
+        {
+            if (!isReferenceSource(row, col, sources, num_sources))
+            {
+                rows[row][col] = function(referenceNeighbor(rows, row, col + 1, n, m, isCyclic),
+                                          referenceNeighbor(rows, row + 1, col, n, m, isCyclic),
+                                          referenceNeighbor(rows, row, col - 1, n, m, isCyclic),
+                                          referenceNeighbor(rows, row - 1, col, n, m, isCyclic));
+            }
+        }
+    }
+}
+
+/**
+ * this function measures the reference sweep like timeSweeps, if it fits in REFERENCE_BUDGET
+ * @param function : the function that calculates the new value of the cell
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @return the seconds of a sweep, or a negative value if it doesn't fit (or the memory couldn't be allocated)
+ */
+double timeReferenceSweeps(diff_func function, size_t n, size_t m, const source_point *sources,
+                           size_t num_sources, int isCyclic)
+{
+    double cost = (double) n * m * (num_sources > 0 ? num_sources : 1);
+    double *cells = (double *) calloc(n * m, sizeof(double));
+    double **rows = (double **) malloc(n * sizeof(double *));
+    if (cost > REFERENCE_BUDGET || cells == NULL || rows == NULL)
+    {
+        free(cells);
+        free(rows);
+        return -1;
+    }
+    size_t row, i;
+    for (row = 0; row < n; ++row)
+    {
+        rows[row] = cells + row * m;
+    }
+    for (i = 0; i < num_sources; ++i)
+    {
+        rows[sources[i].x][sources[i].y] = sources[i].value;
+    }
+    unsigned int sweeps = 1, done = 0;
+    double seconds = 0;
+    while (seconds < MIN_BENCH_SECONDS && (done + sweeps) * cost <= REFERENCE_BUDGET)
+    {
+        double start = benchSeconds();
+        for (i = 0; i < sweeps; ++i)
+        {
+            referenceSweep(function, rows, n, m, isCyclic, sources, num_sources);
+        }
+        seconds += benchSeconds() - start;
+        done += sweeps;
+        sweeps *= 2;
+    }
+    free(rows);
+    free(cells);
+    return done > 0 ? seconds / done : -1;
+}
+
+/**
+ * this function prints the cells a sweep updates every second in a column of a table
+ * @param seconds : the seconds of a sweep, or a negative value if it wasn't measured
+ * @param cells : the number of cells of the grid
+ */
+void printCellRate(double seconds, size_t cells)
+{
+    if (seconds < 0)
+    {
+        printf(" %14s", "-");
+        return;
+    }
+    printf(" %14.1f", (double) cells / seconds / 1e6);
+}
+
+/**
+ * this function prints the time of a cell update in a column of a table
+ * @param seconds : the seconds of a sweep, or a negative value if it wasn't measured
+ * @param cells : the number of cells of the grid
+ */
+void printCellTime(double seconds, size_t cells)
+{
+    if (seconds < 0)
+    {
+        printf(" %14s", "-");
+        return;
+    }
+    printf(" %14.2f", seconds / (double) cells * 1e9);
+}
+
+/**
+ * this function benchmarks the cost of a sweep with more and more source points- the source mask keeps it flat,
+ * while the reference sweep scans all of them for every cell
+ * @param limits : the limits of the benchmarks
+ */
+void benchSources(const bench_limits *limits)
+{
+    size_t size = capSize(SOURCES_GRID_SIZE, limits), stride, i;
+    printf("sources: %zux%zu Gauss-Seidel, ns per cell update\n", size, size);
+    printf("%10s %14s %14s\n", "sources", "mask", "reference");
+    double *grid = allocStridedGrid(size, size, &stride);
+    for (i = 0; grid != NULL && i < sizeof(SOURCE_COUNTS) / sizeof(SOURCE_COUNTS[0]); ++i)
+    {
+        source_point *sources = randomSources(size, size, SOURCE_COUNTS[i]);
+        if (sources == NULL)
+        {
+            break;
+        }
+        printf("%10zu", SOURCE_COUNTS[i]);
+        printCellTime(timeSweeps(heat_eqn, grid, stride, size, size, sources, SOURCE_COUNTS[i], 0, NULL),
+                      size * size);
+        printCellTime(timeReferenceSweeps(heat_eqn, size, size, sources, SOURCE_COUNTS[i], 0), size * size);
+        printf("\n");
+        free(sources);
+    }
+    freeStridedGrid(grid, stride);
+}
+
+/**
+ * this function benchmarks the rate of a sweep- the interior of the grid without a branch and its edges (zero
+ * padded or wrapped) in passes of their own- against the reference sweep that finds every neighbor with a mod,
+ * on the grid of input.txt and on a large one
+ * @param limits : the limits of the benchmarks
+ */
+void benchSweep(const bench_limits *limits)
+{
+    size_t numSources = sizeof(INPUT_SOURCES) / sizeof(INPUT_SOURCES[0]), i;
+    source_point sources[sizeof(INPUT_SOURCES) / sizeof(INPUT_SOURCES[0])];
+    printf("sweep: Gauss-Seidel with the source points of input.txt, M cells per second\n");
+    printf("%12s %10s %14s %14s\n", "grid", "cyclic", "sweep", "reference");
+    for (i = 0; i < sizeof(SWEEP_SIZES) / sizeof(SWEEP_SIZES[0]); ++i)
+    {
+        size_t size = capSize(SWEEP_SIZES[i], limits), stride;
+        int isCyclic;
+        if (size < SWEEP_SIZES[0])
+        { // the source points of input.txt wouldn't fit
+            continue;
+        }
+        memcpy(sources, INPUT_SOURCES, sizeof(INPUT_SOURCES));
+        double *grid = allocStridedGrid(size, size, &stride);
+        for (isCyclic = 0; grid != NULL && isCyclic <= 1; ++isCyclic)
+        {
+            printf("%5zux%-6zu %10s", size, size, isCyclic ? "yes" : "no");
+            printCellRate(timeSweeps(heat_eqn, grid, stride, size, size, sources, numSources, isCyclic, NULL),
+                          size * size);
+            printCellRate(timeReferenceSweeps(heat_eqn, size, size, sources, numSources, isCyclic), size * size);
+            printf("\n");
+        }
+        freeStridedGrid(grid, stride);
+    }
+}
+
+/**
+ * this function tells if two functions give the same cells on the grid of the stencil benchmark
+ * @param function : the first function
+ * @param other : the second function
+ * @param size : the side of the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param options : the options of the calculation
+ * @return 1 if the cells are the same bits after STENCIL_CHECK_SWEEPS sweeps and 0 otherwise
+ */
+int isSameStencil(diff_func function, diff_func other, size_t size, source_point *sources, size_t num_sources,
+                  const calc_options *options)
+{
+    size_t stride, otherStride, row;
+    double *grid = allocStridedGrid(size, size, &stride), *otherGrid = allocStridedGrid(size, size, &otherStride);
+    int isSame = grid != NULL && otherGrid != NULL &&
+                 calculateWithOptions(function, grid, stride, size, size, sources, num_sources, 0,
+                                      STENCIL_CHECK_SWEEPS, 0, options) >= 0 &&
+                 calculateWithOptions(other, otherGrid, otherStride, size, size, sources, num_sources, 0,
+                                      STENCIL_CHECK_SWEEPS, 0, options) >= 0;
+    for (row = 0; isSame && row < size; ++row)
+    {
+        isSame = memcmp(grid + row * stride, otherGrid + row * otherStride, size * sizeof(double)) == 0;
+    }
+    freeStridedGrid(grid, stride);
+    freeStridedGrid(otherGrid, otherStride);
+    return isSame;
+}
+
+/**
+ * this function benchmarks the kernels specialized for the built-in heat equation (its stencil inlined in the
+ * sweep) against the generic kernels that call the function through its pointer for every cell, in every
+ * engine that has both
+ * @param limits : the limits of the benchmarks
+ */
+void benchStencil(const bench_limits *limits)
+{
+    static const iteration_scheme SCHEMES[] = {GAUSS_SEIDEL, SOR, JACOBI};
+    static const char *SCHEME_NAMES[] = {"gauss-seidel", "sor", "jacobi"};
+    size_t size = capSize(STENCIL_GRID_SIZE, limits), stride, i;
+    printf("stencil: %zux%zu, M cells per second\n", size, size);
+    printf("%14s %14s %14s %10s %10s\n", "engine", "inlined", "pointer", "speedup", "same");
+    source_point *sources = randomSources(size, size, STENCIL_SOURCES);
+    double *grid = allocStridedGrid(size, size, &stride);
+    for (i = 0; sources != NULL && grid != NULL && i < sizeof(SCHEMES) / sizeof(SCHEMES[0]); ++i)
+    {
+        calc_options options;
+        initCalcOptions(&options);
+        options.scheme = SCHEMES[i];
+        double inlined = timeSweeps(heat_eqn, grid, stride, size, size, sources, STENCIL_SOURCES, 0, &options);
+        double pointer = timeSweeps(pointerHeatEqn, grid, stride, size, size, sources, STENCIL_SOURCES, 0,
+                                    &options);
+        printf("%14s", SCHEME_NAMES[i]);
+        printCellRate(inlined, size * size);
+        printCellRate(pointer, size * size);
+        printf(" %9.2fx %10s\n", pointer / inlined,
+               isSameStencil(heat_eqn, pointerHeatEqn, size, sources, STENCIL_SOURCES, &options) ? "yes" : "NO");
+    }
+    freeStridedGrid(grid, stride);
+    free(sources);
+}
+
+/**
+ * this function benchmarks how the red-black sweep scales with its threads
+ * @param limits : the limits of the benchmarks
+ */
+void benchThreads(const bench_limits *limits)
+{
+    size_t size = capSize(THREADS_GRID_SIZE, limits), stride, i;
+    printf("threads: %zux%zu red-black on %ld cpus\n", size, size, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%10s %14s %14s %10s\n", "threads", "sweeps/s", "M cells/s", "speedup");
+    source_point *sources = randomSources(size, size, STENCIL_SOURCES);
+    double *grid = allocStridedGrid(size, size, &stride), single = 0;
+    for (i = 0; sources != NULL && grid != NULL && i < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); ++i)
+    {
+        calc_options options;
+        initCalcOptions(&options);
+        options.scheme = RED_BLACK;
+        options.num_threads = THREAD_COUNTS[i];
+        double seconds = timeSweeps(heat_eqn, grid, stride, size, size, sources, STENCIL_SOURCES, 0, &options);
+        if (seconds < 0)
+        {
+            break;
+        }
+        single = i == 0 ? seconds : single;
+        printf("%10u %14.1f", THREAD_COUNTS[i], 1 / seconds);
+        printCellRate(seconds, size * size);
+        printf(" %9.2fx\n", single / seconds);
+    }
+    freeStridedGrid(grid, stride);
+    free(sources);
+}
+
+/**
+ * this function finds the largest difference between a cell and the heat equation of its neighbors- how far the
+ * grid is from the steady state
+ * @param grid : the strided grid of all the cells holding their values, not cyclic (its halo is zero)
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sources : the list of the source points, that aren't checked
+ * @param num_sources : the number of source points
+ * @return the residual, or a negative value if the memory couldn't be allocated
+ */
+double steadyResidual(const double *grid, size_t stride, size_t n, size_t m, const source_point *sources,
+                      size_t num_sources)
+{
+    unsigned char *isSource = (unsigned char *) calloc(n * m, sizeof(unsigned char));
+    if (isSource == NULL)
+    {
+        return -1;
+    }
+    size_t row, col, i;
+    for (i = 0; i < num_sources; ++i)
+    {
+        isSource[sources[i].x * m + sources[i].y] = 1;
+    }
+    double residual = 0;
+    for (row = 0; row < n; ++row)
+    {
+        const double *cell = grid + row * stride;
+        for (col = 0; col < m; ++col)
+        {
+            double change = fabs(heatEqnStencil(cell[col + 1], cell[col + stride], cell[col - 1],
+                                                cell[col - stride]) - cell[col]);
+            if (!isSource[row * m + col] && change > residual)
+            {
+                residual = change;
+            }
+        }
+    }
+    free(isSource);
+    return residual;
+}
+
+/**
+ * this function runs a calculation until terminate in a solver- with multigrid until its own check says it is
+ * over, or with Gauss-Seidel rounds of MULTIGRID_CHECK_SWEEPS sweeps until the last sweep of a round is below
+ * terminate or the budget is spent
+ * @param solver : the solver
+ * @param scheme : MULTIGRID or GAUSS_SEIDEL
+ * @param size : the side of the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param sweeps : the pointer for the number of sweeps (or V-cycles) run
+ * @param residual : the pointer for the residual of the grid at the end
+ * @return the seconds the calculation took (above MULTIGRID_BUDGET if it stopped there), or a negative value if
+ * the memory couldn't be allocated
+ */
+double timeConvergence(solver_context *solver, iteration_scheme scheme, size_t size, const source_point *sources,
+                       size_t num_sources, unsigned long *sweeps, double *residual)
+{
+    calc_options options;
+    convergence_report report = {0, 0};
+    initCalcOptions(&options);
+    options.scheme = scheme;
+    options.report = &report;
+    unsigned int n_iter = scheme == MULTIGRID ? 0 : MULTIGRID_CHECK_SWEEPS;
+    if (configureSolver(solver, heat_eqn, size, size, MULTIGRID_TERMINATE, n_iter, 0, &options) != 0)
+    {
+        return -1;
+    }
+    setSolverSources(solver, sources, num_sources);
+    double start = benchSeconds(), seconds = 0, result;
+    *sweeps = 0;
+    do
+    {
+        result = runSolver(solver);
+        seconds = benchSeconds() - start;
+        *sweeps = n_iter > 0 ? *sweeps + n_iter : report.sweeps;
+    } while (result >= MULTIGRID_TERMINATE && seconds <= MULTIGRID_BUDGET);
+    size_t stride;
+    const double *grid = getSolverGrid(solver, &stride);
+    *residual = result < 0 ? -1 : steadyResidual(grid, stride, size, size, sources, num_sources);
+    return result < 0 || *residual < 0 ? -1 : seconds;
+}
+
+/**
+ * this function benchmarks the time multigrid takes to converge against Gauss-Seidel on larger and larger grids
+ * @param limits : the limits of the benchmarks
+ */
+void benchMultigrid(const bench_limits *limits)
+{
+    static const iteration_scheme SCHEMES[] = {MULTIGRID, GAUSS_SEIDEL};
+    printf("multigrid: until the heat difference is below %g, seconds (sweeps or V-cycles, residual)\n",
+           MULTIGRID_TERMINATE);
+    printf("%12s %36s %36s\n", "grid", "multigrid", "gauss-seidel");
+    solver_context *solver = createSolver();
+    int isBudgetSpent = 0;
+    size_t size;
+    for (size = MULTIGRID_FIRST_SIZE; solver != NULL && size <= capSize(MULTIGRID_LAST_SIZE, limits); size *= 2)
+    {
+        source_point sources[] = {{(int) size / 4, (int) size / 4, 100}, {(int) size / 4, (int) size * 3 / 4, -50},
+                                  {(int) size * 3 / 4, (int) size / 2, 75}};
+        size_t num_sources = sizeof(sources) / sizeof(sources[0]), i;
+        printf("%5zux%-6zu", size, size);
+        for (i = 0; i < sizeof(SCHEMES) / sizeof(SCHEMES[0]); ++i)
+        {
+            unsigned long sweeps;
+            double residual, seconds = -1;
+            if (SCHEMES[i] == MULTIGRID || !isBudgetSpent)
+            {
+                seconds = timeConvergence(solver, SCHEMES[i], size, sources, num_sources, &sweeps, &residual);
+            }
+            if (seconds < 0)
+            {
+                printf(" %36s", "-");
+                continue;
+            }
+            char text[64];
+            snprintf(text, sizeof(text), "%s%.2f (%lu, %.1e)", seconds > MULTIGRID_BUDGET ? ">" : "", seconds,
+                     sweeps, residual);
+            printf(" %36s", text);
+            isBudgetSpent = isBudgetSpent || seconds > MULTIGRID_BUDGET;
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    destroySolver(solver);
+}
+
+/**
+ * this function runs STENCIL_CHECK_SWEEPS Jacobi sweeps of a new grid with the given instructions
+ * @param simd : the widest instructions of the kernel
+ * @param size : the side of the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param stride : a pointer for the distance between two rows of the grid
+ * @return the grid, or NULL if the memory couldn't be allocated
+ */
+double *simdSweptGrid(simd_level simd, size_t size, source_point *sources, size_t num_sources, size_t *stride)
+{
+    calc_options options;
+    initCalcOptions(&options);
+    options.scheme = JACOBI;
+    options.simd = simd;
+    double *grid = allocStridedGrid(size, size, stride);
+    if (grid != NULL && calculateWithOptions(heat_eqn, grid, *stride, size, size, sources, num_sources, 0,
+                                             STENCIL_CHECK_SWEEPS, 0, &options) < 0)
+    {
+        freeStridedGrid(grid, *stride);
+        return NULL;
+    }
+    return grid;
+}
+
+/**
+ * this function benchmarks the Jacobi kernel of the built-in heat equation with every set of instructions the cpu
+ * has, on a single thread, and checks that they all give the cells of the scalar one
+ * @param limits : the limits of the benchmarks
+ */
+void benchSimd(const bench_limits *limits)
+{
+    static const simd_level LEVELS[] = {SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512};
+    static const char *LEVEL_NAMES[] = {"scalar", "sse2", "avx2", "avx512"};
+    size_t size = capSize(SIMD_GRID_SIZE, limits), stride, scalarStride, i;
+    printf("simd: %zux%zu Jacobi on a single thread, M cells per second\n", size, size);
+    printf("%10s %14s %10s %10s\n", "kernel", "M cells/s", "speedup", "same");
+    source_point *sources = randomSources(size, size, STENCIL_SOURCES);
+    double *grid = allocStridedGrid(size, size, &stride), scalar = 0;
+    double *scalarCells = sources != NULL ? simdSweptGrid(SIMD_SCALAR, size, sources, STENCIL_SOURCES,
+                                                          &scalarStride) : NULL;
+    for (i = 0; scalarCells != NULL && grid != NULL && i < sizeof(LEVELS) / sizeof(LEVELS[0]); ++i)
+    {
+        printf("%10s", LEVEL_NAMES[i]);
+        if (detectSimdLevel(LEVELS[i]) != LEVELS[i])
+        { // the cpu doesn't have them
+            printf(" %14s %10s %10s\n", "-", "-", "-");
+            continue;
+        }
+        calc_options options;
+        initCalcOptions(&options);
+        options.scheme = JACOBI;
+        options.simd = LEVELS[i];
+        double seconds = timeSweeps(heat_eqn, grid, stride, size, size, sources, STENCIL_SOURCES, 0, &options);
+        if (seconds < 0)
+        {
+            printf("\n");
+            break;
+        }
+        size_t cellsStride, row;
+        double *cells = simdSweptGrid(LEVELS[i], size, sources, STENCIL_SOURCES, &cellsStride);
+        int isSame = cells != NULL;
+        for (row = 0; isSame && row < size; ++row)
+        {
+            isSame = memcmp(cells + row * cellsStride, scalarCells + row * scalarStride,
+                            size * sizeof(double)) == 0;
+        }
+        freeStridedGrid(cells, cellsStride);
+        scalar = i == 0 ? seconds : scalar;
+        printCellRate(seconds, size * size);
+        printf(" %9.2fx %10s\n", scalar / seconds, isSame ? "yes" : "NO");
+    }
+    freeStridedGrid(scalarCells, scalarStride);
+    freeStridedGrid(grid, stride);
+    free(sources);
+}
+
+/**
+ * this function allocates a grid of cells like the ones of a round- random values with many digits, some of
+ * them negative
+ * @param size : the side of the grid
+ * @param stride : a pointer for the distance between two rows of the grid
+ * @return the grid, or NULL if the allocation failed
+ */
+double *randomCellsGrid(size_t size, size_t *stride)
+{
+    double *grid = allocStridedGrid(size, size, stride);
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    size_t row, col;
+    for (row = 0; grid != NULL && row < size; ++row)
+    {
+        for (col = 0; col < size; ++col)
+        {
+            grid[row * *stride + col] = ((double) randomBelow(&state, 2000001) - 1000000) / 3e3;
+        }
+    }
+    return grid;
+}
+
+/**
+ * this function prints a round the way the program did at first- the result and every cell with a call of
+ * fprintf
+ * @param file : the stream to print to
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param result : the result of the round
+ * @return the number of bytes printed, or a negative value if printing failed
+ */
+long fprintfRound(FILE *file, const double *grid, size_t stride, size_t n, size_t m, double result)
+{
+    long bytes = fprintf(file, "%lf\n", result);
+    size_t row, col;
+    for (row = 0; bytes >= 0 && row < n; ++row)
+    {
+        for (col = 0; col < m; ++col)
+        {
+            bytes += fprintf(file, "%2.4lf,", grid[row * stride + col]);
+        }
+        bytes += fprintf(file, "\n");
+    }
+    return fflush(file) == 0 ? bytes : -1;
+}
+
+/**
+ * this function measures the rounds of the text writer to NULL_DEVICE, writing them until they take
+ * MIN_BENCH_SECONDS
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param size : the side of the grid
+ * @return the seconds of a round, or a negative value if the writer couldn't be opened or the write failed
+ */
+double timeGridWriter(const double *grid, size_t stride, size_t size)
+{
+    grid_writer writer;
+    int fd = open(NULL_DEVICE, O_WRONLY);
+    if (fd < 0 || openGridWriter(&writer, CSV_OUTPUT, fd) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    unsigned long rounds = 0;
+    double start = benchSeconds(), seconds = 0;
+    while (seconds < MIN_BENCH_SECONDS && seconds >= 0)
+    {
+        seconds = writeRound(&writer, grid, stride, size, size, 1) == 0 ? benchSeconds() - start : -1;
+        ++rounds;
+    }
+    closeGridWriter(&writer);
+    close(fd);
+    return seconds < 0 ? -1 : seconds / rounds;
+}
+
+/**
+ * this function measures the rounds printed with fprintfRound to NULL_DEVICE like timeGridWriter
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param size : the side of the grid
+ * @param bytes : a pointer for the number of bytes of a round
+ * @return the seconds of a round, or a negative value if the file couldn't be opened or printing failed
+ */
+double timeFprintf(const double *grid, size_t stride, size_t size, long *bytes)
+{
+    FILE *file = fopen(NULL_DEVICE, "w");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    unsigned long rounds = 0;
+    double start = benchSeconds(), seconds = 0;
+    while (seconds < MIN_BENCH_SECONDS && seconds >= 0)
+    {
+        *bytes = fprintfRound(file, grid, stride, size, size, 1);
+        seconds = *bytes >= 0 ? benchSeconds() - start : -1;
+        ++rounds;
+    }
+    fclose(file);
+    return seconds < 0 ? -1 : seconds / rounds;
+}
+
+/**
+ * this function tells if the text writer gives the text of fprintfRound, on a grid of WRITER_CHECK_SIZE
+ * @return 1 if the texts are the same bytes and 0 otherwise
+ */
+int isSameWriterText(void)
+{
+    size_t stride;
+    double *grid = randomCellsGrid(WRITER_CHECK_SIZE, &stride);
+    FILE *printed = tmpfile(), *written = tmpfile();
+    grid_writer writer;
+    int isSame = grid != NULL && printed != NULL && written != NULL &&
+                 fprintfRound(printed, grid, stride, WRITER_CHECK_SIZE, WRITER_CHECK_SIZE, -0.5) >= 0 &&
+                 openGridWriter(&writer, CSV_OUTPUT, fileno(written)) == 0;
+    if (isSame)
+    {
+        isSame = writeRound(&writer, grid, stride, WRITER_CHECK_SIZE, WRITER_CHECK_SIZE, -0.5) == 0;
+        closeGridWriter(&writer);
+        rewind(printed);
+        rewind(written);
+    }
+    while (isSame)
+    {
+        int printedChar = fgetc(printed), writtenChar = fgetc(written);
+        isSame = printedChar == writtenChar;
+        if (printedChar == EOF)
+        {
+            break;
+        }
+    }
+    if (printed != NULL)
+    {
+        fclose(printed);
+    }
+    if (written != NULL)
+    {
+        fclose(written);
+    }
+    freeStridedGrid(grid, stride);
+    return isSame;
+}
+
+/**
+ * this function benchmarks the text writer of the output against a call of fprintf for every cell (the binary
+ * snapshots aren't measured- NULL_DEVICE takes them without copying a byte)
+ * @param limits : the limits of the benchmarks
+ */
+void benchWriter(const bench_limits *limits)
+{
+    size_t size = capSize(WRITER_GRID_SIZE, limits), stride;
+    printf("writer: a round of %zux%zu to %s, MB per second\n", size, size, NULL_DEVICE);
+    printf("%10s %14s %14s %10s %10s\n", "writer", "MB", "MB/s", "speedup", "same");
+    double *grid = randomCellsGrid(size, &stride);
+    long bytes = -1;
+    double printed = grid != NULL ? timeFprintf(grid, stride, size, &bytes) : -1;
+    if (printed < 0)
+    {
+        freeStridedGrid(grid, stride);
+        return;
+    }
+    double text = timeGridWriter(grid, stride, size);
+    printf("%10s %14.1f %14.1f %9.2fx %10s\n", "fprintf", bytes / 1e6, bytes / 1e6 / printed, 1.0, "-");
+    if (text >= 0)
+    {
+        printf("%10s %14.1f %14.1f %9.2fx %10s\n", "text", bytes / 1e6, bytes / 1e6 / text, printed / text,
+               isSameWriterText() ? "yes" : "NO");
+    }
+    freeStridedGrid(grid, stride);
+}
+
+/**
+ * this function runs a calculation until terminate in a solver from the given cells
+ * @param solver : the solver, configured for the calculation
+ * @param cells : the cells to start from in row major order, or NULL for zeros
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param report : the report of the options of the solver, that counts the sweeps
+ * @param seconds : a pointer for the seconds the calculation took
+ * @return the number of sweeps, or 0 if the memory couldn't be allocated
+ */
+unsigned long solveFrom(solver_context *solver, const double *cells, const source_point *sources,
+                        size_t num_sources, convergence_report *report, double *seconds)
+{
+    report->sweeps = 0;
+    report->checks = 0;
+    setSolverCells(solver, cells);
+    setSolverSources(solver, sources, num_sources);
+    double start = benchSeconds();
+    double result = runSolver(solver);
+    *seconds = benchSeconds() - start;
+    return result < 0 ? 0 : report->sweeps;
+}
+
+/**
+ * this function runs a case of the warm start benchmark- it solves a grid until terminate, moves the values of
+ * its source points by WARM_PERTURBATION and solves the new grid from zeros (cold) and from the cells of the
+ * first solution (warm)
+ * @param scheme : the scheme of the calculations
+ * @param size : the side of the grid
+ * @param sources : the list of the source points, whose values are moved
+ * @param num_sources : the number of source points
+ * @return 0 on success and -1 if the memory couldn't be allocated
+ */
+int runWarmCase(iteration_scheme scheme, size_t size, source_point *sources, size_t num_sources)
+{
+    calc_options options;
+    convergence_report report = {0, 0};
+    initCalcOptions(&options);
+    options.scheme = scheme;
+    options.report = &report;
+    solver_context *solver = createSolver();
+    double *steady = (double *) malloc(size * size * sizeof(double)), coldSeconds, warmSeconds;
+    if (solver == NULL || steady == NULL ||
+        configureSolver(solver, heat_eqn, size, size, WARM_TERMINATE, 0, 0, &options) != 0 ||
+        solveFrom(solver, NULL, sources, num_sources, &report, &coldSeconds) == 0)
+    {
+        destroySolver(solver);
+        free(steady);
+        return -1;
+    }
+    size_t stride, row, i;
+    const double *grid = getSolverGrid(solver, &stride);
+    for (row = 0; row < size; ++row)
+    {
+        memcpy(steady + row * size, grid + row * stride, size * sizeof(double));
+    }
+    for (i = 0; i < num_sources; ++i)
+    {
+        sources[i].value *= WARM_PERTURBATION;
+    }
+    unsigned long cold = solveFrom(solver, NULL, sources, num_sources, &report, &coldSeconds);
+    unsigned long warm = solveFrom(solver, steady, sources, num_sources, &report, &warmSeconds);
+    destroySolver(solver);
+    free(steady);
+    if (cold == 0 || warm == 0)
+    {
+        return -1;
+    }
+    printf(" %10lu %10.2f %10lu %10.2f %9.1f%%\n", cold, coldSeconds, warm, warmSeconds,
+           100.0 * ((double) cold - (double) warm) / (double) cold);
+    return 0;
+}
+
+/**
+ * this function benchmarks the warm start- the sweeps a calculation until terminate saves when it starts from
+ * the solution of a slightly different input instead of from zeros
+ * @param limits : the limits of the benchmarks
+ */
+void benchWarmStart(const bench_limits *limits)
+{
+    static const iteration_scheme SCHEMES[] = {GAUSS_SEIDEL, SOR};
+    static const char *SCHEME_NAMES[] = {"gauss-seidel", "sor"};
+    printf("warm start: until the heat difference is below %g, with the source points moved by %g\n",
+           WARM_TERMINATE, WARM_PERTURBATION);
+    printf("%12s %14s %10s %10s %10s %10s %10s\n", "grid", "engine", "cold", "seconds", "warm", "seconds",
+           "saved");
+    size_t i, j;
+    for (i = 0; i < sizeof(WARM_SIZES) / sizeof(WARM_SIZES[0]) && WARM_SIZES[i] <= limits->maxSize; ++i)
+    {
+        for (j = 0; j < sizeof(SCHEMES) / sizeof(SCHEMES[0]); ++j)
+        {
+            source_point *sources = randomSources(WARM_SIZES[i], WARM_SIZES[i], WARM_SOURCES);
+            printf("%5zux%-6zu %14s", WARM_SIZES[i], WARM_SIZES[i], SCHEME_NAMES[j]);
+            if (sources == NULL || runWarmCase(SCHEMES[j], WARM_SIZES[i], sources, WARM_SOURCES) != 0)
+            {
+                printf(" %10s\n", "-");
+            }
+            fflush(stdout);
+            free(sources);
+        }
+    }
+}
+
+/**
+ * this function runs STENCIL_CHECK_SWEEPS sweeps of a new grid with the given options
+ * @param size : the side of the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param options : the options of the calculation
+ * @param stride : a pointer for the distance between two rows of the grid
+ * @return the grid, or NULL if the memory couldn't be allocated
+ */
+double *sweptGrid(size_t size, source_point *sources, size_t num_sources, const calc_options *options,
+                  size_t *stride)
+{
+    double *grid = allocStridedGrid(size, size, stride);
+    if (grid != NULL && calculateWithOptions(heat_eqn, grid, *stride, size, size, sources, num_sources, 0,
+                                             STENCIL_CHECK_SWEEPS, 0, options) < 0)
+    {
+        freeStridedGrid(grid, *stride);
+        return NULL;
+    }
+    return grid;
+}
+
+/**
+ * this function benchmarks the block sweeps- Gauss-Seidel and SOR sweeps of n_iter run several at a time in a
+ * single pass over the rows- against sweeping one by one, and checks that they give the same cells
+ * @param limits : the limits of the benchmarks
+ */
+void benchBlocks(const bench_limits *limits)
+{
+    static const iteration_scheme SCHEMES[] = {GAUSS_SEIDEL, SOR};
+    static const char *SCHEME_NAMES[] = {"gauss-seidel", "sor"};
+    printf("blocks: sweeps of n_iter in a single pass over the rows, M cells per second\n");
+    printf("%12s %14s %10s %14s %10s %10s\n", "grid", "engine", "sweeps", "M cells/s", "speedup", "same");
+    size_t i, j, k;
+    for (i = 0; i < sizeof(BLOCK_SIZES) / sizeof(BLOCK_SIZES[0]) && BLOCK_SIZES[i] <= limits->maxSize; ++i)
+    {
+        size_t size = BLOCK_SIZES[i], stride, oneStride;
+        source_point *sources = randomSources(size, size, STENCIL_SOURCES);
+        double *grid = allocStridedGrid(size, size, &stride);
+        for (j = 0; sources != NULL && grid != NULL && j < sizeof(SCHEMES) / sizeof(SCHEMES[0]); ++j)
+        {
+            calc_options options;
+            initCalcOptions(&options);
+            options.scheme = SCHEMES[j];
+            double *oneByOne = sweptGrid(size, sources, STENCIL_SOURCES, &options, &oneStride), single = 0;
+            for (k = 0; oneByOne != NULL && k < sizeof(BLOCK_SWEEPS) / sizeof(BLOCK_SWEEPS[0]); ++k)
+            {
+                options.block_sweeps = BLOCK_SWEEPS[k];
+                double seconds = timeSweeps(heat_eqn, grid, stride, size, size, sources, STENCIL_SOURCES, 0,
+                                            &options);
+                if (seconds < 0)
+                {
+                    break;
+                }
+                size_t cellsStride, row;
+                double *cells = sweptGrid(size, sources, STENCIL_SOURCES, &options, &cellsStride);
+                int isSame = cells != NULL;
+                for (row = 0; isSame && row < size; ++row)
+                {
+                    isSame = memcmp(cells + row * cellsStride, oneByOne + row * oneStride,
+                                    size * sizeof(double)) == 0;
+                }
+                freeStridedGrid(cells, cellsStride);
+                single = k == 0 ? seconds : single;
+                printf("%5zux%-6zu %14s %10u", size, size, SCHEME_NAMES[j], BLOCK_SWEEPS[k]);
+                printCellRate(seconds, size * size);
+                printf(" %9.2fx %10s\n", single / seconds, isSame ? "yes" : "NO");
+                fflush(stdout);
+            }
+            freeStridedGrid(oneByOne, oneStride);
+        }
+        freeStridedGrid(grid, stride);
+        free(sources);
+    }
+}
+
+/**
+ * the benchmarks, in the order they run
+ */
+static const benchmark BENCHMARKS[] = {
+        {"sources", benchSources}, {"sweep", benchSweep}, {"stencil", benchStencil}, {"threads", benchThreads},
+        {"multigrid", benchMultigrid}, {"simd", benchSimd},
+        {"writer", benchWriter}, {"warm", benchWarmStart},
+        {"blocks", benchBlocks}};
+
+/**
+ * this function finds a benchmark by its name
+ * @param name : the name
+ * @return the index of the benchmark in BENCHMARKS, or the number of benchmarks if there is none by that name
+ */
+size_t findBenchmark(const char *name)
+{
+    size_t numBenchmarks = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]), i;
+    for (i = 0; i < numBenchmarks; ++i)
+    {
+        if (strcmp(name, BENCHMARKS[i].name) == 0)
+        {
+            return i;
+        }
+    }
+    return numBenchmarks;
+}
+
+/**
+ * this function runs the benchmarks named on the command line, or all of them
+ * @param argc : the number of arguments
+ * @param argv : the names of the benchmarks and --max-size=N
+ * @return 0 on success and 1 for an unknown argument
+ */
+int main(int argc, char *argv[])
+{
+    bench_limits limits = {DEFAULT_MAX_SIZE};
+    size_t numBenchmarks = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]), i;
+    int isRun[sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0])] = {0}, isNamed = 0, arg;
+    for (arg = 1; arg < argc; ++arg)
+    {
+        if (strncmp(argv[arg], MAX_SIZE_OPTION, strlen(MAX_SIZE_OPTION)) == 0)
+        {
+            char *end;
+            limits.maxSize = (size_t) strtoul(argv[arg] + strlen(MAX_SIZE_OPTION), &end, 10);
+            if (*end != '\0' || limits.maxSize == 0)
+            {
+                fprintf(stderr, "benchmarks: bad option %s\n", argv[arg]);
+                return 1;
+            }
+            continue;
+        }
+        i = findBenchmark(argv[arg]);
+        if (i == numBenchmarks)
+        {
+            fprintf(stderr, "benchmarks: unknown benchmark %s\n", argv[arg]);
+            return 1;
+        }
+        isRun[i] = 1;
+        isNamed = 1;
+    }
+    for (i = 0; i < numBenchmarks; ++i)
+    {
+        if (!isNamed || isRun[i])
+        {
+            BENCHMARKS[i].run(&limits);
+            printf("\n");
+        }
+    }
+    return 0;
+}
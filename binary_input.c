@@ -0,0 +1,293 @@
+/**
+ * @file binary_input.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * the binary input format- loads it from the bytes of a mapped file and writes it
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * a text input file with millions of source points takes a while to parse. the binary input file holds the same
+ * data as it is in memory- an input_header, the source points in the layout of source_point and optionally an
+ * initial grid, all little endian. on a little endian host the source points and the initial grid are used right
+ * where they are in the mapping of the file, so loading it only checks its header and its size. a big endian
+ * host decodes them to the heap.
+ * Input  : the bytes of a binary input file
+ * Process: check the header and the sizes, point to the data
+ * Output : the parameters, the source points and the initial grid
+ */
+
+// ------------------------------ includes ------------------------------
+#include <string.h>
+#include <limits.h>
+#include <stddef.h>
+#include "binary_input.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * the size of a source point record in the file
+ */
+#define SOURCE_RECORD_SIZE 16
+
+/**
+ * the number of records encoded at a time when the layout of the host isn't the layout of the file
+ */
+#define ENCODE_BATCH 4096
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function checks if the layout of source_point and double in memory is the layout of the file
+ * @return 1 if the records can be used where they are and 0 otherwise
+ */
+int isFileLayout(void)
+{
+    const uint16_t one = 1;
+    return *(const unsigned char *) &one == 1 && sizeof(source_point) == SOURCE_RECORD_SIZE &&
+           offsetof(source_point, y) == 4 && offsetof(source_point, value) == 8 && sizeof(int) == 4;
+}
+
+/**
+ * this function reads a little endian number of the given number of bytes
+ * @param bytes : the bytes of the number
+ * @param size : the number of bytes
+ * @return the number
+ */
+uint64_t loadLittleEndian(const unsigned char *bytes, int size)
+{
+    uint64_t value = 0;
+    int i;
+    for (i = size - 1; i >= 0; --i)
+    {
+        value = value << 8 | bytes[i];
+    }
+    return value;
+}
+
+/**
+ * this function writes a number in little endian
+ * @param bytes : the place of the number
+ * @param value : the number
+ * @param size : the number of bytes
+ */
+void storeLittleEndian(unsigned char *bytes, uint64_t value, int size)
+{
+    int i;
+    for (i = 0; i < size; ++i, value >>= 8)
+    {
+        bytes[i] = (unsigned char) (value & 0xff);
+    }
+}
+
+/**
+ * this function reads a little endian double
+ * @param bytes : the bytes of the double
+ * @return the double
+ */
+double loadDouble(const unsigned char *bytes)
+{
+    uint64_t bits = loadLittleEndian(bytes, sizeof(uint64_t));
+    double value;
+    memcpy(&value, &bits, sizeof(double));
+    return value;
+}
+
+/**
+ * this function writes a double in little endian
+ * @param bytes : the place of the double
+ * @param value : the double
+ */
+void storeDouble(unsigned char *bytes, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(double));
+    storeLittleEndian(bytes, bits, sizeof(uint64_t));
+}
+
+/**
+ * this function checks if the given bytes are a binary input file
+ * @param data : the bytes
+ * @param size : the number of bytes
+ * @return 1 if they start with INPUT_MAGIC and 0 otherwise
+ */
+int isBinaryInput(const char *data, size_t size)
+{
+    return size >= INPUT_MAGIC_LENGTH && memcmp(data, INPUT_MAGIC, INPUT_MAGIC_LENGTH) == 0;
+}
+
+/**
+ * this function decodes the source points and the initial grid to the heap
+ * @param input : the input, with its sizes
+ * @param records : the source point records in the file
+ * @param cells : the initial grid in the file, or NULL
+ * @return 0 on success and -2 if the memory couldn't be allocated
+ */
+int decodeBinaryInput(binary_input *input, const unsigned char *records, const unsigned char *cells)
+{
+    size_t i;
+    input->is_decoded = 1;
+    input->sources = (source_point *) malloc((input->num_sources > 0 ? input->num_sources : 1) *
+                                             sizeof(source_point));
+    input->cells = cells != NULL ? (double *) malloc(input->n * input->m * sizeof(double)) : NULL;
+    if (input->sources == NULL || (cells != NULL && input->cells == NULL))
+    {
+        freeBinaryInput(input);
+        return -2;
+    }
+    for (i = 0; i < input->num_sources; ++i, records += SOURCE_RECORD_SIZE)
+    {
+        input->sources[i].x = (int32_t) loadLittleEndian(records, sizeof(int32_t));
+        input->sources[i].y = (int32_t) loadLittleEndian(records + 4, sizeof(int32_t));
+        input->sources[i].value = loadDouble(records + 8);
+    }
+    for (i = 0; cells != NULL && i < input->n * input->m; ++i)
+    {
+        input->cells[i] = loadDouble(cells + i * sizeof(double));
+    }
+    return 0;
+}
+
+/**
+ * this function loads a binary input from the bytes of its file- checks its header and its size and points to
+ * its data (or decodes it)
+ * @param data : the bytes of the file
+ * @param size : the number of bytes
+ * @param input : the input to init
+ * @return 0 on success, -1 for a file that isn't valid and -2 if the memory couldn't be allocated
+ */
+int loadBinaryInput(const char *data, size_t size, binary_input *input)
+{
+    const unsigned char *bytes = (const unsigned char *) data;
+    if (size < sizeof(input_header) || !isBinaryInput(data, size))
+    {
+        return -1;
+    }
+    uint64_t rows = loadLittleEndian(bytes + offsetof(input_header, rows), sizeof(uint64_t));
+    uint64_t cols = loadLittleEndian(bytes + offsetof(input_header, cols), sizeof(uint64_t));
+    uint64_t numSources = loadLittleEndian(bytes + offsetof(input_header, num_sources), sizeof(uint64_t));
+    uint32_t nIter = (uint32_t) loadLittleEndian(bytes + offsetof(input_header, n_iter), sizeof(uint32_t));
+    uint32_t isCyclic = (uint32_t) loadLittleEndian(bytes + offsetof(input_header, is_cyclic), sizeof(uint32_t));
+    uint32_t hasGrid = (uint32_t) loadLittleEndian(bytes + offsetof(input_header, has_grid), sizeof(uint32_t));
+    size_t remaining = size - sizeof(input_header);
+    // the limits of the text format- the sizes and the number of iterations are ints
+    if (rows == 0 || cols == 0 || rows > INT_MAX || cols > INT_MAX || nIter > INT_MAX || isCyclic > 1 ||
+        hasGrid > 1 || numSources > remaining / SOURCE_RECORD_SIZE)
+    {
+        return -1;
+    }
+    remaining -= numSources * SOURCE_RECORD_SIZE;
+    if (hasGrid ? rows > remaining / sizeof(double) / cols || remaining != rows * cols * sizeof(double)
+                : remaining != 0)
+    {
+        return -1;
+    }
+    input->n = (size_t) rows;
+    input->m = (size_t) cols;
+    input->num_sources = (size_t) numSources;
+    input->terminate = loadDouble(bytes + offsetof(input_header, terminate));
+    input->n_iter = nIter;
+    input->is_cyclic = (int) isCyclic;
+    const unsigned char *records = bytes + sizeof(input_header);
+    const unsigned char *cells = hasGrid ? records + numSources * SOURCE_RECORD_SIZE : NULL;
+    if (!isFileLayout() || (uintptr_t) records % sizeof(double) != 0)
+    {
+        return decodeBinaryInput(input, records, cells);
+    }
+    input->is_decoded = 0;
+    input->sources = (source_point *) records;
+    input->cells = (double *) cells;
+    return 0;
+}
+
+/**
+ * this function releases the memory of a loaded binary input
+ * @param input : the input
+ */
+void freeBinaryInput(binary_input *input)
+{
+    if (input->is_decoded)
+    {
+        free(input->sources);
+        free(input->cells);
+    }
+    input->sources = NULL;
+    input->cells = NULL;
+}
+
+/**
+ * this function writes a binary input file
+ * @param file : the file to write
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param terminate : the termination value
+ * @param n_iter : the number of iterations given
+ * @param is_cyclic : 1 if its cyclic and 0 if its not
+ * @param grid : the strided grid of the initial values, or NULL for a grid of zeros
+ * @param stride : the distance between two rows of the grid
+ * @return 0 on success and -1 if the write failed
+ */
+int writeBinaryInput(FILE *file, size_t n, size_t m, const source_point *sources, size_t num_sources,
+                     double terminate, unsigned int n_iter, int is_cyclic, const double *grid, size_t stride)
+{
+    unsigned char header[sizeof(input_header)] = {0};
+    memcpy(header, INPUT_MAGIC, INPUT_MAGIC_LENGTH);
+    storeLittleEndian(header + offsetof(input_header, rows), n, sizeof(uint64_t));
+    storeLittleEndian(header + offsetof(input_header, cols), m, sizeof(uint64_t));
+    storeLittleEndian(header + offsetof(input_header, num_sources), num_sources, sizeof(uint64_t));
+    storeDouble(header + offsetof(input_header, terminate), terminate);
+    storeLittleEndian(header + offsetof(input_header, n_iter), n_iter, sizeof(uint32_t));
+    storeLittleEndian(header + offsetof(input_header, is_cyclic), (uint64_t) is_cyclic, sizeof(uint32_t));
+    storeLittleEndian(header + offsetof(input_header, has_grid), grid != NULL, sizeof(uint32_t));
+    if (fwrite(header, sizeof(header), 1, file) != 1)
+    {
+        return -1;
+    }
+    if (isFileLayout())
+    {
+        if (fwrite(sources, SOURCE_RECORD_SIZE, num_sources, file) != num_sources)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        static unsigned char records[ENCODE_BATCH * SOURCE_RECORD_SIZE];
+        size_t i, count = 0;
+        for (i = 0; i < num_sources; ++i)
+        {
+            unsigned char *record = records + count * SOURCE_RECORD_SIZE;
+            storeLittleEndian(record, (uint32_t) sources[i].x, sizeof(int32_t));
+            storeLittleEndian(record + 4, (uint32_t) sources[i].y, sizeof(int32_t));
+            storeDouble(record + 8, sources[i].value);
+            if (++count == ENCODE_BATCH || i + 1 == num_sources)
+            {
+                if (fwrite(records, SOURCE_RECORD_SIZE, count, file) != count)
+                {
+                    return -1;
+                }
+                count = 0;
+            }
+        }
+    }
+    size_t row, col;
+    for (row = 0; grid != NULL && row < n; ++row)
+    {
+        for (col = 0; col < m; ++col)
+        {
+            unsigned char cell[sizeof(double)];
+            storeDouble(cell, grid[row * stride + col]);
+            if (fwrite(cell, sizeof(cell), 1, file) != 1)
+            {
+                return -1;
+            }
+        }
+    }
+    return fflush(file) == 0 ? 0 : -1;
+}
@@ -0,0 +1,97 @@
+/*
+ * binary_input.h
+ *
+ * The binary input format- the dimensions, the parameters, the source points and optionally the initial grid,
+ * ready to be used straight from a mapping of the file.
+ */
+#ifndef BINARY_INPUT_H
+#define BINARY_INPUT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "calculator.h"
+
+/**
+ * The first bytes of a binary input file.
+ */
+#define INPUT_MAGIC "HEATGRID"
+
+/**
+ * The length of INPUT_MAGIC (without the terminating null).
+ */
+#define INPUT_MAGIC_LENGTH 8
+
+/**
+ * The header of a binary input file. It is followed by num_sources records of a source point (int32 x, int32 y,
+ * double value- the layout of source_point) and, if has_grid is 1, by rows * cols doubles- the initial grid in
+ * row major order. All the fields are little endian.
+ */
+typedef struct
+{
+    char magic[INPUT_MAGIC_LENGTH];
+    uint64_t rows, cols, num_sources;
+    double terminate;
+    uint32_t n_iter, is_cyclic, has_grid, reserved;
+} input_header;
+
+/**
+ * The content of a binary input file. On a little endian host the source points and the initial grid point into
+ * the bytes of the file; otherwise they are decoded to the heap.
+ */
+typedef struct
+{
+    size_t n, m, num_sources;
+    source_point *sources;
+    /** the initial grid (n * m cells in row major order), or NULL for a grid of zeros */
+    double *cells;
+    double terminate;
+    unsigned int n_iter;
+    int is_cyclic;
+    /** if the source points and the initial grid were decoded to the heap */
+    int is_decoded;
+} binary_input;
+
+/**
+ * Returns 1 if the given bytes start with INPUT_MAGIC and 0 otherwise.
+ */
+int isBinaryInput(const char *data, size_t size);
+
+/**
+ * Loads the binary input in the given bytes (that have to stay valid while it's used). Returns 0 on success, -1
+ * for a file that isn't valid and -2 if the memory couldn't be allocated.
+ */
+int loadBinaryInput(const char *data, size_t size, binary_input *input);
+
+/**
+ * Releases the memory of a loaded binary input.
+ */
+void freeBinaryInput(binary_input *input);
+
+/**
+ * Reads a little endian number of size bytes.
+ */
+uint64_t loadLittleEndian(const unsigned char *bytes, int size);
+
+/**
+ * Reads a little endian double.
+ */
+double loadDouble(const unsigned char *bytes);
+
+/**
+ * Writes a number in size little endian bytes.
+ */
+void storeLittleEndian(unsigned char *bytes, uint64_t value, int size);
+
+/**
+ * Writes a little endian double.
+ */
+void storeDouble(unsigned char *bytes, double value);
+
+/**
+ * Writes a binary input file- the parameters, the source points and, if grid isn't NULL, the initial grid (a
+ * strided grid, see allocStridedGrid). Returns 0 on success and -1 if the write failed.
+ */
+int writeBinaryInput(FILE *file, size_t n, size_t m, const source_point *sources, size_t num_sources,
+                     double terminate, unsigned int n_iter, int is_cyclic, const double *grid, size_t stride);
+
+#endif /* BINARY_INPUT_H */
@@ -0,0 +1,153 @@
+/**
+ * @file calc_stats.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * the statistics of a calculation- the records of its sweeps and the time spent in its parts
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * the engines of the calculator record every sweep when the options point to a calc_stats- its time, the heat
+ * after it and its heat difference, and the residual of the grid after it. the heat is summed by the sweep
+ * itself, but the residual takes a pass of its own over the grid, which is counted as reduction time (with the
+ * summing of the heat of the threads). without statistics the engines only check the pointer once per sweep.
+ * Input  : the grid after a sweep and the times of the sweep
+ * Process: find the residual and add a record
+ * Output : the statistics
+ */
+
+// ------------------------------ includes ------------------------------
+#include <string.h>
+#include <time.h>
+#include "sweep.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * the number of records the statistics start with (it doubles when they fill)
+ */
+#define INITIAL_RECORDS 256
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function gives the time of a monotonic clock
+ * @return the time in seconds
+ */
+double statsSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+}
+
+/**
+ * this function finds the residual of the grid- the largest difference between a cell that isn't a source point
+ * and the value the function gives it from its neighbors. the neighbors are read from the board (wrapped, for
+ * a cyclic grid), not from the halo, which the engines may leave stale.
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sourceMask : the source mask filled by markSources
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @return the residual (NaN if a cell is NaN)
+ */
+double getResidual(diff_func function, const double *grid, size_t stride, size_t n, size_t m,
+                   const unsigned char *sourceMask, int isCyclic)
+{
+    double residual = 0;
+    size_t row, col;
+    for (row = 0; row < n; ++row)
+    {
+        const double *rowCells = grid + row * stride;
+        const double *nextRow = row + 1 < n ? rowCells + stride : isCyclic ? grid : NULL;
+        const double *lastRow = row > 0 ? rowCells - stride : isCyclic ? grid + (n - 1) * stride : NULL;
+        const unsigned char *rowMask = sourceMask + row * m;
+        for (col = 0; col < m; ++col)
+        {
+            if (rowMask[col])
+            {
+                continue;
+            }
+            double right = col + 1 < m ? rowCells[col + 1] : isCyclic ? rowCells[0] : 0;
+            double left = col > 0 ? rowCells[col - 1] : isCyclic ? rowCells[m - 1] : 0;
+            double difference = fabs(function(right, nextRow != NULL ? nextRow[col] : 0, left,
+                                              lastRow != NULL ? lastRow[col] : 0) - rowCells[col]);
+            if (!(difference <= residual))
+            { // NaN stays
+                residual = difference;
+            }
+        }
+    }
+    return residual;
+}
+
+/**
+ * this function adds the record of a sweep (or of a pass of sweeps) to the statistics, with the residual of
+ * the grid after it
+ * @param stats : the statistics
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the strided grid of all the cells holding their values, after the sweep
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sourceMask : the source mask filled by markSources
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @param sweeps : the number of sweeps the record stands for
+ * @param start : the time the update of the cells started
+ * @param reductionStart : the time the update ended and the reduction started
+ * @param initialHeat : the heat of the grid before the (last) sweep
+ * @param currHeat : the heat of the grid after the sweep
+ */
+void recordSweep(calc_stats *stats, diff_func function, const double *grid, size_t stride, size_t n, size_t m,
+                 const unsigned char *sourceMask, int isCyclic, unsigned int sweeps, double start,
+                 double reductionStart, double initialHeat, double currHeat)
+{
+    double residual = getResidual(function, grid, stride, n, m, sourceMask, isCyclic);
+    stats->update_seconds += reductionStart - start;
+    stats->reduction_seconds += statsSeconds() - reductionStart;
+    stats->total_sweeps += sweeps;
+    if (stats->num_sweeps == stats->capacity && !stats->is_truncated)
+    {
+        size_t capacity = stats->capacity > 0 ? stats->capacity * 2 : INITIAL_RECORDS;
+        sweep_record *records = (sweep_record *) realloc(stats->sweeps, capacity * sizeof(sweep_record));
+        if (records == NULL)
+        {
+            stats->is_truncated = 1;
+        }
+        else
+        {
+            stats->sweeps = records;
+            stats->capacity = capacity;
+        }
+    }
+    if (stats->is_truncated)
+    {
+        return;
+    }
+    sweep_record *record = &stats->sweeps[stats->num_sweeps++];
+    record->round = stats->rounds;
+    record->sweeps = sweeps;
+    record->seconds = reductionStart - start;
+    record->heat = currHeat;
+    record->heat_diff = fabs(currHeat - initialHeat);
+    record->residual = residual;
+}
+
+/**
+ * this function frees the records of the statistics
+ * @param stats : the statistics
+ */
+void freeCalcStats(calc_stats *stats)
+{
+    free(stats->sweeps);
+    stats->sweeps = NULL;
+    stats->num_sweeps = 0;
+    stats->capacity = 0;
+}
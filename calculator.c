@@ -19,19 +19,22 @@
 
 // ------------------------------ includes ------------------------------
 #include <stdio.h>
+#include <string.h>
+#include <stddef.h>
 #include <tgmath.h>
-#include "calculator.h"
+#include "sweep.h"
 
 // -------------------------- const definitions -------------------------
 
 /**
- * @var the directions of the neighbors for a current cell
- *@brief names of the different directions for the cell's neighbors
+ * the number of doubles in a cache line- rows of a strided grid are padded to a multiple of it
  */
-typedef enum Directions
-{
-    UP, DOWN, RIGHT, LEFT
-} Direction;
+#define LINE_DOUBLES (GRID_ALIGNMENT / sizeof(double))
+
+/**
+ * the number of rows and columns of an active tile, unless the options say otherwise
+ */
+#define DEFAULT_TILE_SIZE 32
 
 /**
  * true and false indicators for convenience
@@ -42,168 +45,679 @@ typedef enum Directions
 // ------------------------------ functions -----------------------------
 
 /**
- * this function calculates mod operation using floor other that rounding through zero.
- * (in positive numbers its the same as % but in negative num the result is different)
- * @param x the value we want to calculate an Integer
- * @param N the filed of mod to calculate. a non negative num
- * @return mod(x,N) the reminder after division of x in N.
+ * this function fills the source mask of the grid- a flag per cell that tells if the cell is a source point.
+ * it is filled once per calculation so the sweep does not need to scan the list of sources for every cell.
+ * @param mask : the mask to fill (n * m flags in row major order)
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
  */
-int myMod(int x, int N)
+void markSources(unsigned char *mask, size_t n, size_t m, const source_point *sources, size_t num_sources)
 {
-    return (x % N + N) % N;
+    memset(mask, 0, n * m * sizeof(unsigned char));
+    size_t i;
+    for (i = 0; i < num_sources; ++i)
+    {
+        mask[sources[i].x * m + sources[i].y] = 1;
+    }
 }
 
 /**
- * this function returns the value of the wanted neighbor of the given cell.
- * @param direction : the direction of the neighbor in relation to the given cell (up,down,right,left)
- * @param grid : the grid of all the cells holding their values
- * @param rowIndex : the row index of the cell we want to check
- * @param colIndex : the col index of the cell we want to check
+ * this function zeroes the halo around the grid, so the neighbors out of the board are read as zero
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
  * @param n : the number of rows in the grid
  * @param m : the number of columns in the grid
- * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic we will use mod to get the neighbors
- * @return the value of the wanted neighbor
  */
-double getNeighbor(Direction direction, double **grid, int rowIndex, int colIndex, size_t n, size_t m, int isCyclic)
+void clearHalo(double *grid, size_t stride, size_t n, size_t m)
 {
-    int rowNeighbor = rowIndex, colNeighbor = colIndex;
-    switch (direction)
+    int row;
+    memset(grid - stride - 1, 0, (m + 2) * sizeof(double));
+    memset(grid + n * stride - 1, 0, (m + 2) * sizeof(double));
+    for (row = 0; row < n; ++row)
     {
-        case UP:
-            rowNeighbor++;
-            break;
-        case DOWN:
-            rowNeighbor--;
-            break;
-        case RIGHT:
-            colNeighbor++;
-            break;
-        case LEFT:
-            colNeighbor--;
-            break;
+        grid[row * stride - 1] = 0;
+        grid[row * stride + m] = 0;
     }
-    if (isCyclic)
+}
+
+DEFINE_RUN_KERNEL(updateFunctionRun, function, 1)
+
+DEFINE_RUN_KERNEL(updateHeatRun, heatEqnStencil, 1)
+
+/**
+ * defines a function like the ones of DEFINE_RUN_KERNEL (with a step of 1) for successive over-relaxation-
+ * every cell moves omega times the way from its value to STENCIL(right, top, left, bottom). it also gets:
+ * omega : the relaxation factor
+ */
+#define DEFINE_SOR_KERNEL(name, STENCIL) \
+static void name(diff_func function, double *rowCells, size_t stride, const unsigned char *rowMask, size_t from, \
+                 size_t to, double omega, heat_sum *heat) \
+{ \
+    size_t col; \
+    double sum = heat->sum, compensation = heat->compensation; \
+    (void) function; \
+    for (col = from; col < to; ++col) \
+    { \
+        if (!rowMask[col]) \
+        { \
+            rowCells[col] += omega * (STENCIL(rowCells[col + 1], rowCells[col + stride], rowCells[col - 1], \
+                                              rowCells[col - stride]) - rowCells[col]); \
+        } \
+        ADD_HEAT(sum, compensation, rowCells[col]); \
+    } \
+    heat->sum = sum; \
+    heat->compensation = compensation; \
+}
+
+DEFINE_SOR_KERNEL(relaxFunctionRun, function)
+
+DEFINE_SOR_KERNEL(relaxHeatRun, heatEqnStencil)
+
+/**
+ * this function copies the wrapped rows and columns of a cyclic grid into its halo, as they are right now
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ */
+void wrapHalo(double *grid, size_t stride, size_t n, size_t m)
+{
+    int row;
+    memcpy(grid - stride, grid + (n - 1) * stride, m * sizeof(double));
+    memcpy(grid + n * stride, grid, m * sizeof(double));
+    for (row = 0; row < n; ++row)
     {
-        rowNeighbor = myMod(rowNeighbor, n);
-        colNeighbor = myMod(colNeighbor, m);
+        grid[row * stride - 1] = grid[row * stride + m - 1];
+        grid[row * stride + m] = grid[row * stride];
     }
-    if (rowNeighbor >= n || rowNeighbor < 0 || colNeighbor >= m || colNeighbor < 0)
-    { // the index is out of the board
-        return 0;
-    }
-    return grid[rowNeighbor][colNeighbor];
 }
 
 /**
- * this function returns TRUE if the given cell is a source point and FALSE otherwise
- * @param rowIndex : the row index of the cell we want to check
- * @param colIndex : the col index of the cell we want to check
- * @param sources : the list of the source points
- * @param num_sources : the number of source points
- * @return TRUE if the given cell is a source point and FALSE otherwise
+ * this function updates a run of cells in a row with the given function- through the inlined kernel of the
+ * built-in heat equation when that is the function, and through the function pointer otherwise. with a
+ * relaxation factor other than 1 the cells are over-relaxed.
+ * @param function : the function that calculates the new value of the cell
+ * @param rowCells : the first cell of the row in the strided grid
+ * @param stride : the distance between two rows of the grid
+ * @param rowMask : the source mask of the row
+ * @param from : the first column to update
+ * @param to : the column after the last one to update
+ * @param omega : the relaxation factor (1 for plain Gauss-Seidel)
+ * @param heat : the heat sum of the sweep
  */
-int isSourcePoint(int rowIndex, int colIndex, source_point *sources, size_t num_sources)
+void updateRun(diff_func function, double *rowCells, size_t stride, const unsigned char *rowMask, size_t from,
+               size_t to, double omega, heat_sum *heat)
 {
-    int i;
-    for (i = 0; i < num_sources; ++i)
+    if (omega != 1)
     {
-        if (sources[i].x == rowIndex && sources[i].y == colIndex)
+        if (function == heat_eqn)
+        {
+            relaxHeatRun(function, rowCells, stride, rowMask, from, to, omega, heat);
+        }
+        else
         {
-            return TRUE;
+            relaxFunctionRun(function, rowCells, stride, rowMask, from, to, omega, heat);
         }
     }
-    return FALSE;
+    else if (function == heat_eqn)
+    {
+        updateHeatRun(function, rowCells, stride, rowMask, from, to, heat);
+    }
+    else
+    {
+        updateFunctionRun(function, rowCells, stride, rowMask, from, to, heat);
+    }
+}
+
+/**
+ * this function updates a row of a cyclic grid. the left halo gets the last cell of the row before the
+ * first cell is updated, and the right halo gets the first cell after it is updated (or before, for a single
+ * column), so the wrapped neighbors are read exactly as the sweep order sees them.
+ * @param function : the function that calculates the new value of the cell
+ * @param rowCells : the first cell of the row in the strided grid
+ * @param stride : the distance between two rows of the grid
+ * @param m : the number of columns in the grid
+ * @param rowMask : the source mask of the row
+ * @param omega : the relaxation factor (1 for plain Gauss-Seidel)
+ * @param heat : the heat sum of the sweep
+ */
+void updateCyclicRow(diff_func function, double *rowCells, size_t stride, size_t m, const unsigned char *rowMask,
+                     double omega, heat_sum *heat)
+{
+    rowCells[-1] = rowCells[m - 1];
+    if (m == 1)
+    {
+        rowCells[m] = rowCells[0];
+        updateRun(function, rowCells, stride, rowMask, 0, 1, omega, heat);
+        return;
+    }
+    updateRun(function, rowCells, stride, rowMask, 0, 1, omega, heat);
+    rowCells[m] = rowCells[0];
+    updateRun(function, rowCells, stride, rowMask, 1, m, omega, heat);
 }
 
 /**
  * this function goes throw all the cells in the grid and if the cell is not a source point, it will
- * use the function given to calculate it's new value.
+ * use the function given to calculate it's new value. the heat of the grid is summed in the same pass.
+ * out of the board neighbors are read from the halo- zeros, or for a cyclic grid the wrapped row or column,
+ * copied into the halo right before it is needed. so every cell reads its neighbors directly.
  * @param function : the function that calculates the new value of the cell
- * @param grid : the grid of all the cells holding their values
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
  * @param n : the number of rows in the grid
  * @param m : the number of columns in the grid
- * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic we will use mod to get the neighbors
- * @param sources : the list of the source points
-* @param num_sources : the number of source points
+ * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic the halo holds the wrapped neighbors
+ * @param sourceMask : the source mask filled by markSources
+ * @param omega : the relaxation factor (1 for plain Gauss-Seidel)
+ * @return the sum of all the values in the grid after the update
  */
-void updateAllValues(diff_func function, double **grid, size_t n, size_t m, int isCyclic, source_point *sources,
-                     size_t num_sources)
+double updateAllValues(diff_func function, double *grid, size_t stride, size_t n, size_t m, int isCyclic,
+                       const unsigned char *sourceMask, double omega)
+{
+    int row;
+    heat_sum heat = {0, 0};
+    if (!isCyclic)
+    {
+        for (row = 0; row < n; ++row)
+        {
+            updateRun(function, grid + row * stride, stride, sourceMask + row * m, 0, m, omega, &heat);
+        }
+        return heat.sum + heat.compensation;
+    }
+    // the first row wraps to the last one before it is updated
+    memcpy(grid - stride, grid + (n - 1) * stride, m * sizeof(double));
+    for (row = 0; row < n; ++row)
+    {
+        if (row == n - 1)
+        { // the last row wraps to the already updated first one
+            memcpy(grid + n * stride, grid, m * sizeof(double));
+        }
+        updateCyclicRow(function, grid + row * stride, stride, m, sourceMask + row * m, omega, &heat);
+    }
+    return heat.sum + heat.compensation;
+}
+
+/**
+ * this function sums all the values in the grid, the same way the sweep sums them
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @return the sum of all the values in the grid
+ */
+double getSumOfHeat(const double *grid, size_t stride, size_t n, size_t m)
 {
     int row, col;
-    double up, down, right, left;
+    double sum = 0, compensation = 0;
     for (row = 0; row < n; ++row)
     {
+        const double *rowCells = grid + row * stride;
         for (col = 0; col < m; ++col)
         {
-            if (isSourcePoint(row, col, sources, num_sources) == FALSE)
+            ADD_HEAT(sum, compensation, rowCells[col]);
+        }
+    }
+    return sum + compensation;
+}
+
+/**
+ * this function finds the size of the block of a strided grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param stride : a pointer for the distance between two rows of the grid
+ * @return the size of the block in doubles
+ */
+size_t stridedGridSize(size_t n, size_t m, size_t *stride)
+{
+    // a line of padding before the row (ending with the left halo) and the right halo after it
+    *stride = (LINE_DOUBLES + m + 1 + LINE_DOUBLES - 1) / LINE_DOUBLES * LINE_DOUBLES;
+    return (n + 2) * *stride;
+}
+
+/**
+ * this function allocates a strided grid- one aligned block holding all the rows with a zeroed halo around them.
+ * the rows are padded so that every row starts a cache line, and the halo column left of a row is the last
+ * cell of the line before it.
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param stride : a pointer for the distance between two rows of the grid
+ * @return a pointer to the cell (0, 0) of the grid, or NULL if the allocation failed
+ */
+double *allocStridedGrid(size_t n, size_t m, size_t *stride)
+{
+    size_t size = stridedGridSize(n, m, stride) * sizeof(double);
+    void *block;
+    if (posix_memalign(&block, GRID_ALIGNMENT, size) != 0)
+    {
+        return NULL;
+    }
+    memset(block, 0, size);
+    return gridInBlock(block, *stride);
+}
+
+/**
+ * this function finds the cell (0, 0) of a strided grid placed in a block
+ * @param block : the block, of stridedGridSize doubles
+ * @param stride : the distance between two rows of the grid
+ * @return a pointer to the cell (0, 0) of the grid
+ */
+double *gridInBlock(void *block, size_t stride)
+{
+    return (double *) block + stride + LINE_DOUBLES;
+}
+
+/**
+ * this function frees a grid allocated by allocStridedGrid
+ * @param grid : the grid to free
+ * @param stride : the distance between two rows of the grid
+ */
+void freeStridedGrid(double *grid, size_t stride)
+{
+    if (grid != NULL)
+    {
+        free(grid - stride - LINE_DOUBLES);
+    }
+}
+
+/**
+ * this function estimates the optimal relaxation factor for the grid from its dimensions- the one of the
+ * discrete Laplace equation on an n by m board, 2 / (1 + sqrt(1 - rho^2)) where rho is the spectral radius
+ * of a Jacobi sweep on that board.
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @return the estimated relaxation factor
+ */
+double estimateOmega(size_t n, size_t m)
+{
+    double rho = (cos(M_PI / (n + 1)) + cos(M_PI / (m + 1))) / 2;
+    return 2 / (1 + sqrt(1 - rho * rho));
+}
+
+/**
+ * this function runs several in place sweeps of a grid that isn't cyclic in a single pass over its rows- a
+ * wavefront where sweep t updates row k - t while sweep 0 updates row k. every row is updated by sweep t only
+ * after the row above it was (by sweep t) and the row below it was (by sweep t - 1), exactly as in separate
+ * sweeps, so the results are identical, but only the last few rows have to stay in the cache.
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sourceMask : the source mask filled by markSources
+ * @param omega : the relaxation factor (1 for plain Gauss-Seidel)
+ * @param sweeps : the number of sweeps to run
+ * @param heat : the heat sums of the sweeps, one for every sweep
+ */
+void updateWavefront(diff_func function, double *grid, size_t stride, size_t n, size_t m,
+                     const unsigned char *sourceMask, double omega, unsigned int sweeps, heat_sum *heat)
+{
+    size_t front, row;
+    unsigned int sweep;
+    for (sweep = 0; sweep < sweeps; ++sweep)
+    {
+        heat[sweep].sum = 0;
+        heat[sweep].compensation = 0;
+    }
+    for (front = 0; front < n + sweeps - 1; ++front)
+    {
+        for (sweep = 0; sweep < sweeps && sweep <= front; ++sweep)
+        {
+            row = front - sweep;
+            if (row < n)
             {
-                up = getNeighbor(UP, grid, row, col, n, m, isCyclic);
-                down = getNeighbor(DOWN, grid, row, col, n, m, isCyclic);
-                right = getNeighbor(RIGHT, grid, row, col, n, m, isCyclic);
-                left = getNeighbor(LEFT, grid, row, col, n, m, isCyclic);
-                grid[row][col] = function(right, up, left, down);
+                updateRun(function, grid + row * stride, stride, sourceMask + row * m, 0, m, omega, &heat[sweep]);
             }
         }
     }
 }
 
 /**
- * this function sums all the values in the grid
- * @param grid : the grid of all the cells holding their values
+ * this function runs n_iter in place sweeps of a grid that isn't cyclic, blockSweeps at a time with
+ * updateWavefront.
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
  * @param n : the number of rows in the grid
  * @param m : the number of columns in the grid
- * @return the sum of all the values in the grid
+ * @param sourceMask : the source mask filled by markSources
+ * @param n_iter : the number of iterations given
+ * @param omega : the relaxation factor (1 for plain Gauss-Seidel)
+ * @param blockSweeps : the number of sweeps in every pass over the rows
+ * @param heat : room for the heat sums of the blockSweeps sweeps of a pass
+ * @param initialHeatAmount : a pointer for the heat before the last sweep- the heat of the grid when called
+ * @param currHeatAmount : a pointer for the heat after the last sweep
+ * @param stats : the statistics to record every pass in, or NULL
  */
-double getSumOfHeat(double **grid, size_t n, size_t m)
+void calculateTemporalBlocks(diff_func function, double *grid, size_t stride, size_t n, size_t m,
+                             const unsigned char *sourceMask, unsigned int n_iter, double omega,
+                             unsigned int blockSweeps, heat_sum *heat, double *initialHeatAmount,
+                             double *currHeatAmount, calc_stats *stats)
 {
-    int row, col;
-    double sum = 0;
-    for (row = 0; row < n; ++row)
+    unsigned int done = 0;
+    while (done < n_iter)
     {
-        for (col = 0; col < m; ++col)
+        unsigned int sweeps = n_iter - done < blockSweeps ? n_iter - done : blockSweeps;
+        double start = stats != NULL ? statsSeconds() : 0;
+        updateWavefront(function, grid, stride, n, m, sourceMask, omega, sweeps, heat);
+        *initialHeatAmount = sweeps > 1 ? heat[sweeps - 2].sum + heat[sweeps - 2].compensation : *currHeatAmount;
+        *currHeatAmount = heat[sweeps - 1].sum + heat[sweeps - 1].compensation;
+        done += sweeps;
+        if (stats != NULL)
         {
-            sum += grid[row][col];
+            recordSweep(stats, function, grid, stride, n, m, sourceMask, 0, sweeps, start, statsSeconds(),
+                        *initialHeatAmount, *currHeatAmount);
         }
     }
-    return sum;
 }
 
 /**
- * this function calculates the heat equation.
+ * this function runs the in place Gauss-Seidel (or over-relaxed) sweeps of the heat equation.
  * @param function : the function that calculates the new value of the cell
- * @param grid : the grid of all the cells holding their values
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
  * @param n : the number of rows in the grid
  * @param m : the number of columns in the grid
- * @param sources : the list of the source points
- * @param num_sources : the number of source points
- * @param terminate : the termination value
+ * @param sourceMask : the source mask filled by markSources
+ * @param check : the convergence check, for n_iter zero
  * @param n_iter : the number of iterations given
- * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic we will use mod to get the neighbors
- * @return the heat difference in the last round
+ * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic the halo holds the wrapped neighbors
+ * @param omega : the relaxation factor (1 for plain Gauss-Seidel)
+ * @param blockSweeps : the number of sweeps to run in a single pass over the rows (with n_iter, if the grid
+ *                      isn't cyclic), or 1 to run them one by one
+ * @param stats : the statistics to record every sweep in, or NULL
+ * @param scratch : the memory of the round- the heat sums of the blocks and the active tiles to sweep (or NULL
+ *                  for sweeping all the cells)
+ * @return the heat difference in the last round (or the measure of the convergence check, for n_iter zero)
  */
-double calculate(diff_func function, double **grid, size_t n, size_t m, source_point *sources,
-                 size_t num_sources, double terminate, unsigned int n_iter, int is_cyclic)
+double calculateGaussSeidel(diff_func function, double *grid, size_t stride, size_t n, size_t m,
+                            const unsigned char *sourceMask, convergence_check *check, unsigned int n_iter,
+                            int is_cyclic, double omega, unsigned int blockSweeps, calc_stats *stats,
+                            const round_scratch *scratch)
 {
-    double initialHeatAmount = getSumOfHeat(grid, n, m);
+    tile_tracker *tiles = scratch->activeTiles;
+    double initialHeatAmount = roundStartHeat(check, grid, stride, n, m);
     double currHeatAmount = initialHeatAmount;
+    if (n_iter > 0 && blockSweeps > 1 && !is_cyclic && tiles == NULL && scratch->blockHeat != NULL)
+    { // the sweeps run in blocks
+        calculateTemporalBlocks(function, grid, stride, n, m, sourceMask, n_iter, omega, blockSweeps,
+                                scratch->blockHeat, &initialHeatAmount, &currHeatAmount, stats);
+        return fabs(currHeatAmount - initialHeatAmount);
+    }
     if (n_iter > 0)
     { // the number of iterations is initialized with a positive value
         int i;
         for (i = 0; i < n_iter; ++i)
         {
+            double start = stats != NULL ? statsSeconds() : 0;
             initialHeatAmount = currHeatAmount;
-            updateAllValues(function, grid, n, m, is_cyclic, sources, num_sources);
-            currHeatAmount = getSumOfHeat(grid, n, m);
+            currHeatAmount = tiles != NULL
+                             ? updateActiveTiles(function, grid, stride, n, m, is_cyclic, sourceMask, omega, tiles)
+                             : updateAllValues(function, grid, stride, n, m, is_cyclic, sourceMask, omega);
+            if (stats != NULL)
+            {
+                recordSweep(stats, function, grid, stride, n, m, sourceMask, is_cyclic, 1, start, statsSeconds(),
+                            initialHeatAmount, currHeatAmount);
+            }
         }
     }
     else
     { // n_iter is zero so we use the terminate value
         do
         {
+            double start = stats != NULL ? statsSeconds() : 0;
+            prepareSweep(check, grid, stride);
             initialHeatAmount = currHeatAmount;
-            updateAllValues(function, grid, n, m, is_cyclic, sources, num_sources);
-            currHeatAmount = getSumOfHeat(grid, n, m);
-        } while (fabs(currHeatAmount - initialHeatAmount) >= terminate);
+            currHeatAmount = tiles != NULL
+                             ? updateActiveTiles(function, grid, stride, n, m, is_cyclic, sourceMask, omega, tiles)
+                             : updateAllValues(function, grid, stride, n, m, is_cyclic, sourceMask, omega);
+            if (stats != NULL)
+            {
+                recordSweep(stats, function, grid, stride, n, m, sourceMask, is_cyclic, 1, start, statsSeconds(),
+                            initialHeatAmount, currHeatAmount);
+            }
+        } while (!finishSweep(check, grid, stride, initialHeatAmount, currHeatAmount));
+        return check->metric;
     }
     return fabs(currHeatAmount - initialHeatAmount);
 }
+
+/**
+ * this function inits the options of the calculation to the defaults- in place Gauss-Seidel on one thread
+ * (and an automatic relaxation factor for SOR)
+ * @param options : the options to init
+ */
+void initCalcOptions(calc_options *options)
+{
+    options->scheme = GAUSS_SEIDEL;
+    options->num_threads = 1;
+    options->num_processes = 1;
+    options->omega = AUTO_OMEGA;
+    options->block_sweeps = 1;
+    options->simd = SIMD_AUTO;
+    options->stats = NULL;
+    options->convergence = CHECK_HEAT;
+    options->check_every = 1;
+    options->report = NULL;
+    options->tile_threshold = 0;
+    options->tile_size = DEFAULT_TILE_SIZE;
+    options->on_progress = NULL;
+    options->progress_context = NULL;
+    options->progress_every = 0;
+    options->resume = NULL;
+}
+
+/**
+ * this function lays out the memory of a round of the calculation in an arena- the source mask, the copy of the
+ * grid for the convergence check, the heat sums of the temporal blocks and the active tiles, each only when the
+ * options use it. with an arena that has no block it only counts their size.
+ * @param scratch : the memory of the round to lay out
+ * @param arena : the arena
+ * @param function : the function that calculates the new value of the cell
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param n_iter : the number of iterations given
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @param options : the options of the calculation
+ */
+void layoutRoundScratch(round_scratch *scratch, calc_arena *arena, diff_func function, size_t n, size_t m,
+                        unsigned int n_iter, int is_cyclic, const calc_options *options)
+{
+    scratch->sourceMask = (unsigned char *) arenaAlloc(arena, n * m * sizeof(unsigned char));
+    scratch->before = needsGridCopy(options, n_iter) ? (double *) arenaAlloc(arena, n * m * sizeof(double)) : NULL;
+    scratch->blockHeat = n_iter > 0 && options->block_sweeps > 1 && !is_cyclic
+                         ? (heat_sum *) arenaAlloc(arena, options->block_sweeps * sizeof(heat_sum)) : NULL;
+    scratch->activeTiles = NULL;
+    if (options->tile_threshold > 0 && options->scheme != RED_BLACK && options->scheme != JACOBI &&
+        !(options->scheme == MULTIGRID && function == heat_eqn))
+    { // the engine sweeps in place
+        layoutTileTracker(&scratch->tiles, arena, options->tile_threshold, options->tile_size, n, m);
+        scratch->activeTiles = &scratch->tiles;
+    }
+}
+
+/**
+ * this function runs a round of the calculation with the iteration engine chosen in the options, in the memory
+ * of the given scratch.
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param scratch : the memory of the round, laid out by layoutRoundScratch, with its source mask filled
+ * @param terminate : the termination value
+ * @param n_iter : the number of iterations given
+ * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic the halo holds the wrapped neighbors
+ * @param options : the options of the calculation
+ * @return the heat difference in the round (or the norm its convergence check measured, see
+ * convergence_policy), or a negative value if an engine couldn't allocate its memory
+ */
+double calculateRound(diff_func function, double *grid, size_t stride, size_t n, size_t m, round_scratch *scratch,
+                      double terminate, unsigned int n_iter, int is_cyclic, const calc_options *options)
+{
+    const unsigned char *sourceMask = scratch->sourceMask;
+    convergence_check check;
+    initConvergence(&check, options, terminate, n_iter, n, m, scratch->before);
+    check.tiles = scratch->activeTiles;
+    if (scratch->activeTiles != NULL)
+    {
+        resetTileTracker(scratch->activeTiles);
+    }
+    if (options->resume != NULL && n_iter == 0)
+    { // the round goes on from where it was stopped
+        resumeConvergence(&check, options->resume, scratch->activeTiles);
+    }
+    clearHalo(grid, stride, n, m);
+    if (options->stats != NULL)
+    {
+        ++options->stats->rounds;
+        options->stats->cells = n * m;
+    }
+    double result;
+    switch (options->scheme)
+    {
+        case JACOBI:
+            if (options->num_processes > 1)
+            {
+                result = calculateDistributed(function, grid, stride, n, m, sourceMask, &check, n_iter, is_cyclic,
+                                              options->num_processes, options->num_threads, options->simd,
+                                              options->stats);
+                break;
+            }
+            result = calculateParallel(function, grid, stride, n, m, sourceMask, &check, n_iter, is_cyclic,
+                                       options->scheme, options->num_threads, options->simd, options->stats);
+            break;
+        case RED_BLACK:
+            result = calculateParallel(function, grid, stride, n, m, sourceMask, &check, n_iter, is_cyclic,
+                                       options->scheme, options->num_threads, options->simd, options->stats);
+            break;
+        case MULTIGRID:
+            if (function == heat_eqn)
+            {
+                result = calculateMultigrid(grid, stride, n, m, sourceMask, &check, n_iter, is_cyclic,
+                                            options->stats);
+                break;
+            }
+            // the multigrid correction is only valid for the built-in (linear) stencil
+            result = calculateGaussSeidel(function, grid, stride, n, m, sourceMask, &check, n_iter, is_cyclic,
+                                          1, options->block_sweeps, options->stats, scratch);
+            break;
+        case SOR:
+            result = calculateGaussSeidel(function, grid, stride, n, m, sourceMask, &check, n_iter, is_cyclic,
+                                          options->omega > 0 ? options->omega : estimateOmega(n, m),
+                                          options->block_sweeps, options->stats, scratch);
+            break;
+        default:
+            result = calculateGaussSeidel(function, grid, stride, n, m, sourceMask, &check, n_iter, is_cyclic,
+                                          1, options->block_sweeps, options->stats, scratch);
+            break;
+    }
+    if (scratch->activeTiles != NULL && options->stats != NULL)
+    {
+        options->stats->updated_tiles += scratch->activeTiles->updated;
+        options->stats->skipped_tiles += scratch->activeTiles->skipped;
+    }
+    endConvergence(&check, options->report);
+    return result;
+}
+
+/**
+ * this function calculates the heat equation with the iteration engine chosen in the options. the memory of the
+ * round is a single block, freed at the end (a solver_context keeps it between rounds).
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param terminate : the termination value
+ * @param n_iter : the number of iterations given
+ * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic the halo holds the wrapped neighbors
+ * @param options : the options of the calculation, or NULL for the defaults
+ * @return the heat difference in the last round (or the norm its convergence check measured, see
+ * convergence_policy), or a negative value if the memory couldn't be allocated
+ */
+double calculateWithOptions(diff_func function, double *grid, size_t stride, size_t n, size_t m,
+                            source_point *sources, size_t num_sources, double terminate, unsigned int n_iter,
+                            int is_cyclic, const calc_options *options)
+{
+    calc_options defaults;
+    if (options == NULL)
+    {
+        initCalcOptions(&defaults);
+        options = &defaults;
+    }
+    calc_arena arena;
+    round_scratch scratch;
+    initArena(&arena);
+    layoutRoundScratch(&scratch, &arena, function, n, m, n_iter, is_cyclic, options); // only counts its size
+    if (reserveArena(&arena, arena.used) != 0)
+    {
+        return -1;
+    }
+    layoutRoundScratch(&scratch, &arena, function, n, m, n_iter, is_cyclic, options);
+    markSources(scratch.sourceMask, n, m, sources, num_sources);
+    double result = calculateRound(function, grid, stride, n, m, &scratch, terminate, n_iter, is_cyclic, options);
+    freeArena(&arena);
+    return result;
+}
+
+/**
+ * this function calculates the heat equation with in place Gauss-Seidel sweeps.
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param terminate : the termination value
+ * @param n_iter : the number of iterations given
+ * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic the halo holds the wrapped neighbors
+ * @return the heat difference in the last round, or a negative value if the source mask couldn't be allocated
+ */
+double calculateStrided(diff_func function, double *grid, size_t stride, size_t n, size_t m, source_point *sources,
+                        size_t num_sources, double terminate, unsigned int n_iter, int is_cyclic)
+{
+    return calculateWithOptions(function, grid, stride, n, m, sources, num_sources, terminate, n_iter, is_cyclic,
+                                NULL);
+}
+
+/**
+ * this function calculates the heat equation on a grid given as an array of rows. it copies the grid to the
+ * strided layout, runs calculateStrided on it and copies the results back.
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the grid of all the cells holding their values
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param terminate : the termination value
+ * @param n_iter : the number of iterations given
+ * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic we will use mod to get the neighbors
+ * @return the heat difference in the last round, or a negative value if the memory couldn't be allocated
+ */
+double calculate(diff_func function, double **grid, size_t n, size_t m, source_point *sources,
+                 size_t num_sources, double terminate, unsigned int n_iter, int is_cyclic)
+{
+    size_t stride, row;
+    double *stridedGrid = allocStridedGrid(n, m, &stride);
+    if (stridedGrid == NULL)
+    {
+        return -1;
+    }
+    for (row = 0; row < n; ++row)
+    {
+        memcpy(stridedGrid + row * stride, grid[row], m * sizeof(double));
+    }
+    double result = calculateStrided(function, stridedGrid, stride, n, m, sources, num_sources, terminate, n_iter,
+                                     is_cyclic);
+    for (row = 0; row < n; ++row)
+    {
+        memcpy(grid[row], stridedGrid + row * stride, m * sizeof(double));
+    }
+    freeStridedGrid(stridedGrid, stride);
+    return result;
+}
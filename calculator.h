@@ -23,11 +23,277 @@ typedef struct
  */
 typedef double (*diff_func)(double right, double top, double left, double bottom);
 
+/**
+ * Alignment (in bytes) of the rows of a strided grid- one cache line.
+ */
+#define GRID_ALIGNMENT 64
+
+/**
+ * Allocates a contiguous, cache-line-aligned grid of n rows and m columns, padded with a zeroed halo
+ * row and column on every side. The returned pointer is the cell (0, 0); the cell (i, j) is at
+ * grid[i * stride + j] for -1 <= i <= n and -1 <= j <= m. Returns NULL if the allocation failed.
+ */
+double *allocStridedGrid(size_t n, size_t m, size_t *stride);
+
+/**
+ * Frees a grid allocated by allocStridedGrid.
+ */
+void freeStridedGrid(double *grid, size_t stride);
+
+/**
+ * The order in which a sweep updates the cells of the grid.
+ * GAUSS_SEIDEL - in place, row by row (the default).
+ * RED_BLACK - all the cells with an even row + column first, then all the odd ones, each half split between
+ *             num_threads threads. Wrapped neighbors of a cyclic grid are read as they were when the half began.
+ * JACOBI - every cell from the values of the last sweep into a second grid, split between num_threads threads,
+ *          or between num_processes worker processes that exchange their boundary rows after every sweep.
+ *          The results don't depend on the order of the sweep.
+ * SOR - in place like GAUSS_SEIDEL, over-relaxed: every cell moves omega times the way to its new value.
+ * MULTIGRID - V-cycles toward the steady state, smoothing with GAUSS_SEIDEL sweeps on a hierarchy of coarser
+ *             grids. A round (and an iteration of n_iter) is a whole V-cycle. Only for the built-in heat_eqn-
+ *             with another function it falls back to GAUSS_SEIDEL.
+ */
+typedef enum
+{
+    GAUSS_SEIDEL, RED_BLACK, JACOBI, SOR, MULTIGRID
+} iteration_scheme;
+
+/**
+ * A relaxation factor that tells SOR to estimate the optimal one from the dimensions of the grid.
+ */
+#define AUTO_OMEGA 0
+
+/**
+ * The vector instructions the kernels may use. SIMD_AUTO uses the widest ones the cpu has.
+ */
+typedef enum
+{
+    SIMD_AUTO, SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512
+} simd_level;
+
+/**
+ * When a calculation until terminate (n_iter 0) is over, checked every check_every sweeps.
+ * CHECK_HEAT - the heat difference of the sweep is below terminate (the default). The sweep sums it anyway, so it
+ *              is checked after every sweep- check_every is ignored.
+ * CHECK_MAX_NORM - the largest change of a cell in the sweep is below terminate, so no local change is hidden
+ *                  by the sum. The grid is copied before every checked sweep.
+ * CHECK_L2_NORM - the L2 norm of the changes of the cells in the sweep is below terminate. The grid is copied
+ *                 before every checked sweep.
+ * CHECK_PREDICTIVE - the largest change of a cell is below terminate, like CHECK_MAX_NORM, checked when its
+ *                    contraction between the last checks predicts it will be (half way there, at the most
+ *                    PREDICTION_LIMIT sweeps ahead). Only the checked sweeps copy the grid.
+ * With a norm, the result of a round is the norm in its last sweep instead of the heat difference.
+ */
+typedef enum
+{
+    CHECK_HEAT, CHECK_MAX_NORM, CHECK_L2_NORM, CHECK_PREDICTIVE
+} convergence_policy;
+
+/**
+ * The most sweeps CHECK_PREDICTIVE runs between two checks.
+ */
+#define PREDICTION_LIMIT 1024
+
+/**
+ * The counts of the convergence checks, added up over the rounds- the sweeps run until terminate and the
+ * checks among them (the rest are the checks the policy saved).
+ */
+typedef struct
+{
+    unsigned long sweeps, checks;
+} convergence_report;
+
+/**
+ * The record of a sweep of the grid.
+ */
+typedef struct
+{
+    /** the round (the call of the calculator) the sweep was in, counting from 1 */
+    unsigned long round;
+    /** the number of sweeps the record stands for- more than 1 for a pass of block_sweeps sweeps */
+    unsigned int sweeps;
+    /** the wall time of the update of the cells, in seconds */
+    double seconds;
+    /** the heat of the grid after the sweep, and its change in the (last) sweep */
+    double heat, heat_diff;
+    /** the largest difference between a cell and the value the function gives it from its neighbors */
+    double residual;
+} sweep_record;
+
+/**
+ * Statistics of a calculation, filled in by the calculator when the options point to them. They are meant to
+ * start zeroed, and add up over the rounds.
+ */
+typedef struct
+{
+    /** the records of the sweeps, in their order (num_sweeps of capacity are used) */
+    sweep_record *sweeps;
+    size_t num_sweeps, capacity;
+    /** if a record couldn't be allocated- the records stop there, the totals go on */
+    int is_truncated;
+    /** the number of rounds, and the number of cells of the grid */
+    unsigned long rounds;
+    size_t cells;
+    /** the number of sweeps in all the rounds */
+    unsigned long total_sweeps;
+    /** the number of tile updates run and skipped, with active tiles */
+    unsigned long updated_tiles, skipped_tiles;
+    /** the time spent updating the cells, reducing (summing the heat of the threads and finding the residual)
+     * and writing the output (the last is up to the caller) */
+    double update_seconds, reduction_seconds, output_seconds;
+} calc_stats;
+
+/**
+ * Frees the records of the statistics.
+ */
+void freeCalcStats(calc_stats *stats);
+
+/**
+ * Where a round until terminate is after a sweep- what its next sweeps depend on besides the grid, so a round
+ * that was stopped there goes on as if it wasn't.
+ */
+typedef struct
+{
+    /** the heat of the grid after the sweep */
+    double heat;
+    /** the counts of the convergence check- the sweeps and the checks done, the sweep the next check is after and
+     * the sweep of the last one, with the measures of the last check and of the check before it */
+    unsigned long sweeps, checks, next_check, last_check;
+    double metric, last_metric;
+    /** the flags of the active tiles of the next sweep, or NULL (and 0) if all the cells are updated */
+    unsigned char *active_tiles;
+    size_t num_tiles;
+} round_progress;
+
+/**
+ * A function a calculation until terminate calls every progress_every sweeps of a round (unless the round is
+ * over) with the grid after the sweep and where the round is- to checkpoint a round that takes long. context is
+ * the progress_context of the options.
+ */
+typedef void (*progress_func)(void *context, const double *grid, size_t stride, size_t n, size_t m,
+                              const round_progress *progress);
+
+/**
+ * Options of a calculation.
+ */
+typedef struct
+{
+    iteration_scheme scheme;
+    unsigned int num_threads;
+    /** the number of worker processes to split the rows of JACOBI between- 1 (the default) for this one */
+    unsigned int num_processes;
+    /** the relaxation factor of SOR, between 0 and 2 (AUTO_OMEGA to estimate it) */
+    double omega;
+    /**
+     * the number of GAUSS_SEIDEL or SOR sweeps of n_iter to run in a single pass over the rows (a wavefront that
+     * only keeps about that many rows in the cache). The results are identical to sweeping one by one. Grids
+     * that are cyclic or calculations until terminate always sweep one by one. A serial sweep is bound by the
+     * dependency of every cell on the one before it rather than by the memory, so on a single core it runs about
+     * as fast (see the blocks benchmark).
+     */
+    unsigned int block_sweeps;
+    /** the widest instructions the JACOBI kernel of heat_eqn may use- all of them give identical results */
+    simd_level simd;
+    /** the statistics to fill in, or NULL for none (the default)- finding the residual takes a pass of its own */
+    calc_stats *stats;
+    /** when a calculation until terminate is over, checked every check_every sweeps (see convergence_policy) */
+    convergence_policy convergence;
+    unsigned int check_every;
+    /** the counts of the convergence checks to add to, or NULL */
+    convergence_report *report;
+    /**
+     * GAUSS_SEIDEL and SOR sweeps only update the tiles of tile_size x tile_size cells that changed at least by
+     * tile_threshold in the last sweep, or are next to one that did or that did earlier in the sweep (see
+     * active_tiles.c). Every round starts with all the tiles active. 0 (the default) updates all the cells, and
+     * a threshold below every change gives the same cells.
+     */
+    double tile_threshold;
+    unsigned int tile_size;
+    /** the function to call every progress_every sweeps of a round until terminate, or NULL (the default) */
+    progress_func on_progress;
+    void *progress_context;
+    unsigned int progress_every;
+    /** where the next round until terminate goes on from (its grid is the one given), or NULL to start it over */
+    const round_progress *resume;
+} calc_options;
+
+/**
+ * Inits the options to the defaults- in place Gauss-Seidel on one thread, sweeping one by one (SOR with
+ * AUTO_OMEGA) and checking the heat difference after every sweep.
+ */
+void initCalcOptions(calc_options *options);
+
+/**
+ * Calculator function. Like calculateStrided, with the iteration engine chosen in the options (NULL for the defaults).
+ */
+double calculateWithOptions(diff_func function, double *grid, size_t stride, size_t n, size_t m,
+                            source_point *sources, size_t num_sources, double terminate, unsigned int n_iter,
+                            int is_cyclic, const calc_options *options);
+
 /**
  * Calculator function. Applies the given function to every point in the grid iteratively for n_iter loops, or until the cumulative difference is below terminate (if n_iter is 0).
+ * The grid is the strided layout of allocStridedGrid- the halo around it is owned by the calculator.
+ * Returns a negative value if the memory for the calculation can't be allocated.
+ */
+double calculateStrided(diff_func function, double *grid, size_t stride, size_t n, size_t m, source_point *sources,
+                        size_t num_sources, double terminate, unsigned int n_iter, int is_cyclic);
+
+/**
+ * Calculator function. Applies the given function to every point in the grid iteratively for n_iter loops, or until the cumulative difference is below terminate (if n_iter is 0).
+ * Works on a copy of the grid in the strided layout- returns a negative value if the memory can't be allocated.
  */
 double calculate(diff_func function, double **grid, size_t n, size_t m, source_point *sources, size_t num_sources,
                  double terminate, unsigned int n_iter, int is_cyclic);
 
+/**
+ * A reusable solver- it owns a single block of memory (an arena) that holds the grid, the source mask and the
+ * scratch buffers of the sweeps, so solving again with the same dimensions and options allocates nothing. The
+ * engines that run threads (RED_BLACK, JACOBI) and MULTIGRID still allocate their own buffers every round.
+ * The calls go create, configure, (set the cells), set the sources, run every round, and destroy.
+ */
+typedef struct solver_context solver_context;
+
+/**
+ * Creates an unconfigured solver. Returns NULL if the memory couldn't be allocated.
+ */
+solver_context *createSolver(void);
+
+/**
+ * Configures the solver for a calculation of an n x m grid with the given options (NULL for the defaults; the
+ * options are copied, the stats, report, progress context and resume they point to are not). The grid starts
+ * zeroed with no sources. The arena only grows- it is kept if it is large enough. Returns 0 on success and -1 if
+ * the memory couldn't be allocated (the solver is then unconfigured).
+ */
+int configureSolver(solver_context *solver, diff_func function, size_t n, size_t m, double terminate,
+                    unsigned int n_iter, int is_cyclic, const calc_options *options);
+
+/**
+ * Sets the cells of the grid from n * m cells in row major order (NULL for zeros). The sources have to be set
+ * after it.
+ */
+void setSolverCells(solver_context *solver, const double *cells);
+
+/**
+ * Sets the source points of the grid- their values and the source mask. They have to be on the board.
+ */
+void setSolverSources(solver_context *solver, const source_point *sources, size_t num_sources);
+
+/**
+ * Runs a round of the calculation on the grid of the solver. Returns the heat difference in the round (see
+ * calculateWithOptions), or a negative value if an engine couldn't allocate its memory. Only the first round
+ * goes on from the resume of the options.
+ */
+double runSolver(solver_context *solver);
+
+/**
+ * Returns the grid of the solver (the strided layout of allocStridedGrid) and its stride.
+ */
+double *getSolverGrid(const solver_context *solver, size_t *stride);
+
+/**
+ * Frees the solver and its arena.
+ */
+void destroySolver(solver_context *solver);
+
 #endif
 
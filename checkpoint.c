@@ -0,0 +1,329 @@
+/**
+ * @file checkpoint.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * checkpoints of a long calculation- writes them atomically and loads them to resume the calculation
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * a big grid may take hours to converge, and a run that is stopped loses all of it. a checkpoint holds what the
+ * next rounds depend on- the grid, the number of rounds done and the result of the last one (every round starts
+ * from the heat of the grid, so there is nothing else)- and the size of the output after the last round, so the
+ * resumed run writes exactly what the stopped run would have written after it. a round until terminate is a
+ * single round that may take the hours itself, so it is checkpointed every K sweeps too- with where the round is
+ * (the counts of its convergence check, the heat of the grid and its active tiles), so it goes on as if it wasn't
+ * stopped.
+ * a checkpoint is written to a temporary file, synced to the disk and renamed over the former checkpoint, so the
+ * checkpoint file is always a whole checkpoint- the new one or the former one.
+ * Input  : the grid and the state of its rounds, or a checkpoint file
+ * Process: write the checkpoint atomically, or check it belongs to this calculation
+ * Output : the checkpoint file, or the grid and the state of its rounds
+ */
+
+// ------------------------------ includes ------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "checkpoint.h"
+#include "tokenizer.h"
+#include "binary_input.h"
+#include "output.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * the suffix of the temporary file a checkpoint is written to before it replaces the checkpoint file
+ */
+#define TEMP_SUFFIX ".tmp"
+
+/**
+ * the offset basis and the prime of the 64 bit FNV-1a hash
+ */
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function adds a number to an FNV-1a hash, byte by byte from its lowest byte
+ * @param hash : the hash so far
+ * @param value : the number
+ * @return the new hash
+ */
+uint64_t hashNumber(uint64_t hash, uint64_t value)
+{
+    int i;
+    for (i = 0; i < (int) sizeof(uint64_t); ++i, value >>= 8)
+    {
+        hash = (hash ^ (value & 0xff)) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * this function adds the bits of a double to an FNV-1a hash
+ * @param hash : the hash so far
+ * @param value : the double
+ * @return the new hash
+ */
+uint64_t hashDouble(uint64_t hash, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(double));
+    return hashNumber(hash, bits);
+}
+
+/**
+ * this function adds a text to an FNV-1a hash, with its length so two texts in a row can't be split differently
+ * @param hash : the hash so far
+ * @param text : the text, or NULL
+ * @return the new hash
+ */
+uint64_t hashText(uint64_t hash, const char *text)
+{
+    if (text == NULL)
+    {
+        return hashNumber(hash, UINT64_MAX);
+    }
+    size_t length = strlen(text), i;
+    hash = hashNumber(hash, length);
+    for (i = 0; i < length; ++i)
+    {
+        hash = (hash ^ (unsigned char) text[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * this function hashes everything the rounds of a calculation depend on, and the output they are written to.
+ * the threads, the processes and the instructions aren't hashed- they give the same results, so a calculation
+ * can be resumed with others.
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param terminate : the termination value
+ * @param n_iter : the number of iterations given
+ * @param is_cyclic : 1 if its cyclic and 0 if its not
+ * @param options : the options of the calculation
+ * @param output : the name of the output file, or NULL for the standard output
+ * @param is_snapshot : 1 if the output is a snapshot file and 0 otherwise
+ * @return the fingerprint of the calculation
+ */
+uint64_t inputFingerprint(size_t n, size_t m, const source_point *sources, size_t num_sources, double terminate,
+                          unsigned int n_iter, int is_cyclic, const calc_options *options, const char *output,
+                          int is_snapshot)
+{
+    uint64_t hash = FNV_OFFSET;
+    size_t i;
+    hash = hashNumber(hashNumber(hashNumber(hash, n), m), num_sources);
+    for (i = 0; i < num_sources; ++i)
+    {
+        hash = hashNumber(hash, (uint32_t) sources[i].x | (uint64_t) (uint32_t) sources[i].y << 32);
+        hash = hashDouble(hash, sources[i].value);
+    }
+    hash = hashNumber(hashNumber(hashDouble(hash, terminate), n_iter), (uint64_t) is_cyclic);
+    hash = hashNumber(hashDouble(hashNumber(hash, (uint64_t) options->scheme), options->omega),
+                      options->block_sweeps);
+    hash = hashNumber(hashNumber(hashNumber(hash, (uint64_t) options->convergence), options->check_every),
+                      options->tile_size);
+    hash = hashDouble(hash, options->tile_threshold);
+    return hashNumber(hashText(hash, output), (uint64_t) is_snapshot);
+}
+
+/**
+ * this function writes the grid of a checkpoint in row major order
+ * @param file : the file to write
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @return 0 on success and -1 if the write failed
+ */
+int writeCheckpointCells(FILE *file, const double *grid, size_t stride, size_t n, size_t m)
+{
+    size_t row, col;
+    for (row = 0; row < n; ++row)
+    {
+        const double *rowCells = grid + row * stride;
+        if (isLittleEndian())
+        {
+            if (fwrite(rowCells, sizeof(double), m, file) != m)
+            {
+                return -1;
+            }
+            continue;
+        }
+        for (col = 0; col < m; ++col)
+        {
+            unsigned char cell[sizeof(double)];
+            storeDouble(cell, rowCells[col]);
+            if (fwrite(cell, sizeof(cell), 1, file) != 1)
+            {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * this function syncs the directory of a file, so a file renamed in it stays renamed after a crash
+ * @param fileName : the name of the file
+ */
+void syncDirectory(const char *fileName)
+{
+    const char *slash = strrchr(fileName, '/');
+    char *directory = strdup(slash == NULL ? "." : fileName);
+    if (directory == NULL)
+    {
+        return;
+    }
+    if (slash != NULL)
+    {
+        directory[slash == fileName ? 1 : slash - fileName] = '\0';
+    }
+    int fd = open(directory, O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+    free(directory);
+}
+
+/**
+ * this function writes a checkpoint to a temporary file, syncs it to the disk and renames it to the checkpoint
+ * file
+ * @param fileName : the name of the checkpoint file
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param state : the state of the rounds, with where the round in progress is
+ * @return 0 on success and -1 if the write failed
+ */
+int writeCheckpoint(const char *fileName, const double *grid, size_t stride, size_t n, size_t m,
+                    const checkpoint_state *state)
+{
+    char *tempName = (char *) malloc(strlen(fileName) + sizeof(TEMP_SUFFIX));
+    if (tempName == NULL)
+    {
+        return -1;
+    }
+    strcat(strcpy(tempName, fileName), TEMP_SUFFIX);
+    FILE *file = fopen(tempName, "wb");
+    if (file == NULL)
+    {
+        free(tempName);
+        return -1;
+    }
+    unsigned char header[sizeof(checkpoint_header)] = {0};
+    memcpy(header, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LENGTH);
+    storeLittleEndian(header + offsetof(checkpoint_header, rows), n, sizeof(uint64_t));
+    storeLittleEndian(header + offsetof(checkpoint_header, cols), m, sizeof(uint64_t));
+    storeLittleEndian(header + offsetof(checkpoint_header, fingerprint), state->fingerprint, sizeof(uint64_t));
+    storeLittleEndian(header + offsetof(checkpoint_header, rounds), state->rounds, sizeof(uint64_t));
+    storeLittleEndian(header + offsetof(checkpoint_header, output_offset), (uint64_t) state->output_offset,
+                      sizeof(int64_t));
+    storeDouble(header + offsetof(checkpoint_header, result), state->result);
+    const round_progress *progress = &state->progress;
+    storeLittleEndian(header + offsetof(checkpoint_header, sweeps), progress->sweeps, sizeof(uint64_t));
+    storeLittleEndian(header + offsetof(checkpoint_header, checks), progress->checks, sizeof(uint64_t));
+    storeLittleEndian(header + offsetof(checkpoint_header, next_check), progress->next_check, sizeof(uint64_t));
+    storeLittleEndian(header + offsetof(checkpoint_header, last_check), progress->last_check, sizeof(uint64_t));
+    storeLittleEndian(header + offsetof(checkpoint_header, num_tiles), progress->num_tiles, sizeof(uint64_t));
+    storeDouble(header + offsetof(checkpoint_header, heat), progress->heat);
+    storeDouble(header + offsetof(checkpoint_header, metric), progress->metric);
+    storeDouble(header + offsetof(checkpoint_header, last_metric), progress->last_metric);
+    int status = fwrite(header, sizeof(header), 1, file) == 1 &&
+                 writeCheckpointCells(file, grid, stride, n, m) == 0 &&
+                 fwrite(progress->active_tiles, sizeof(unsigned char), progress->num_tiles, file) ==
+                 progress->num_tiles && fflush(file) == 0 && fsync(fileno(file)) == 0 ? 0 : -1;
+    if (fclose(file) != 0 || status != 0 || rename(tempName, fileName) != 0)
+    {
+        remove(tempName);
+        free(tempName);
+        return -1;
+    }
+    syncDirectory(fileName);
+    free(tempName);
+    return 0;
+}
+
+/**
+ * this function loads a checkpoint of this calculation
+ * @param fileName : the name of the checkpoint file
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param fingerprint : the fingerprint of this calculation
+ * @param state : the state of the rounds to load (with a new array for the active tiles of its progress, if any)
+ * @param cells : the pointer for the new array of the n * m cells
+ * @return 0 on success, -1 if the file couldn't be opened, -2 if it isn't a checkpoint of this calculation and
+ * -3 if the memory couldn't be allocated
+ */
+int loadCheckpoint(const char *fileName, size_t n, size_t m, uint64_t fingerprint, checkpoint_state *state,
+                   double **cells)
+{
+    input_cursor input;
+    if (openInput(fileName, &input) != 0)
+    {
+        return -1;
+    }
+    const unsigned char *bytes = (const unsigned char *) input.pos;
+    size_t size = (size_t) (input.end - input.pos), i;
+    if (size < sizeof(checkpoint_header) || memcmp(bytes, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LENGTH) != 0 ||
+        loadLittleEndian(bytes + offsetof(checkpoint_header, rows), sizeof(uint64_t)) != n ||
+        loadLittleEndian(bytes + offsetof(checkpoint_header, cols), sizeof(uint64_t)) != m ||
+        loadLittleEndian(bytes + offsetof(checkpoint_header, fingerprint), sizeof(uint64_t)) != fingerprint ||
+        size - sizeof(checkpoint_header) < n * m * sizeof(double) ||
+        size - sizeof(checkpoint_header) - n * m * sizeof(double) !=
+        loadLittleEndian(bytes + offsetof(checkpoint_header, num_tiles), sizeof(uint64_t)))
+    {
+        closeInput(&input);
+        return -2;
+    }
+    round_progress *progress = &state->progress;
+    progress->num_tiles = (size_t) loadLittleEndian(bytes + offsetof(checkpoint_header, num_tiles),
+                                                    sizeof(uint64_t));
+    *cells = (double *) malloc(n * m * sizeof(double));
+    progress->active_tiles = progress->num_tiles > 0 ? (unsigned char *) malloc(progress->num_tiles) : NULL;
+    if (*cells == NULL || (progress->num_tiles > 0 && progress->active_tiles == NULL))
+    {
+        free(*cells);
+        free(progress->active_tiles);
+        progress->active_tiles = NULL;
+        closeInput(&input);
+        return -3;
+    }
+    state->fingerprint = fingerprint;
+    state->rounds = loadLittleEndian(bytes + offsetof(checkpoint_header, rounds), sizeof(uint64_t));
+    state->output_offset = (int64_t) loadLittleEndian(bytes + offsetof(checkpoint_header, output_offset),
+                                                      sizeof(int64_t));
+    state->result = loadDouble(bytes + offsetof(checkpoint_header, result));
+    progress->sweeps = loadLittleEndian(bytes + offsetof(checkpoint_header, sweeps), sizeof(uint64_t));
+    progress->checks = loadLittleEndian(bytes + offsetof(checkpoint_header, checks), sizeof(uint64_t));
+    progress->next_check = loadLittleEndian(bytes + offsetof(checkpoint_header, next_check), sizeof(uint64_t));
+    progress->last_check = loadLittleEndian(bytes + offsetof(checkpoint_header, last_check), sizeof(uint64_t));
+    progress->heat = loadDouble(bytes + offsetof(checkpoint_header, heat));
+    progress->metric = loadDouble(bytes + offsetof(checkpoint_header, metric));
+    progress->last_metric = loadDouble(bytes + offsetof(checkpoint_header, last_metric));
+    for (i = 0; i < n * m; ++i)
+    {
+        (*cells)[i] = loadDouble(bytes + sizeof(checkpoint_header) + i * sizeof(double));
+    }
+    if (progress->num_tiles > 0)
+    {
+        memcpy(progress->active_tiles, bytes + sizeof(checkpoint_header) + n * m * sizeof(double),
+               progress->num_tiles);
+    }
+    closeInput(&input);
+    return 0;
+}
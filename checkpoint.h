@@ -0,0 +1,80 @@
+/*
+ * checkpoint.h
+ *
+ * Checkpoints of a long calculation- the grid and the state of its rounds, written atomically, to resume the
+ * calculation where it was stopped.
+ */
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "calculator.h"
+
+/**
+ * The first bytes of a checkpoint file.
+ */
+#define CHECKPOINT_MAGIC "HEATCKPT"
+
+/**
+ * The length of CHECKPOINT_MAGIC (without the terminating null).
+ */
+#define CHECKPOINT_MAGIC_LENGTH 8
+
+/**
+ * The header of a checkpoint file. It is followed by rows * cols doubles- the grid in row major order- and by
+ * num_tiles bytes- the flags of the active tiles of the round in progress. The fields from sweeps on are where
+ * the round in progress is (see round_progress), all zero between two rounds. All the fields are little endian.
+ */
+typedef struct
+{
+    char magic[CHECKPOINT_MAGIC_LENGTH];
+    uint64_t rows, cols, fingerprint, rounds;
+    int64_t output_offset;
+    double result;
+    uint64_t sweeps, checks, next_check, last_check, num_tiles;
+    double heat, metric, last_metric;
+} checkpoint_header;
+
+/**
+ * The state of the rounds of a calculation at a checkpoint.
+ */
+typedef struct
+{
+    /** the fingerprint of the input and the options of the calculation (see inputFingerprint) */
+    uint64_t fingerprint;
+    /** the number of rounds done and written, and the result of the last one */
+    uint64_t rounds;
+    double result;
+    /** the size of the output after the last round, or -1 if the output isn't a file */
+    int64_t output_offset;
+    /** where the round after the last one is, if it was stopped in the middle (no sweeps between two rounds) */
+    round_progress progress;
+} checkpoint_state;
+
+/**
+ * Returns a hash of everything the rounds of a calculation depend on- the input and the options of the
+ * calculation (but not the threads, the processes and the instructions, that give the same results)- and of the
+ * output they are written to (its name, NULL for the standard output, and if it's a snapshot), so a checkpoint
+ * isn't resumed by another calculation or cuts another output.
+ */
+uint64_t inputFingerprint(size_t n, size_t m, const source_point *sources, size_t num_sources, double terminate,
+                          unsigned int n_iter, int is_cyclic, const calc_options *options, const char *output,
+                          int is_snapshot);
+
+/**
+ * Writes a checkpoint of the grid (a strided grid, see allocStridedGrid) to the given file- to a temporary file
+ * next to it that replaces it once it is on the disk. Returns 0 on success and -1 if the write failed.
+ */
+int writeCheckpoint(const char *fileName, const double *grid, size_t stride, size_t n, size_t m,
+                    const checkpoint_state *state);
+
+/**
+ * Loads the checkpoint in the given file to state and to a new array of n * m cells in row major order (the
+ * active tiles of its progress, if any, are a new array too). Returns 0 on success, -1 if the file couldn't be
+ * opened, -2 if it isn't a checkpoint of this calculation and -3 if the memory couldn't be allocated.
+ */
+int loadCheckpoint(const char *fileName, size_t n, size_t m, uint64_t fingerprint, checkpoint_state *state,
+                   double **cells);
+
+#endif /* CHECKPOINT_H */
@@ -0,0 +1,261 @@
+/**
+ * @file convergence.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * the convergence checks of a calculation until terminate- when to check and what is checked
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * the heat difference of a sweep is summed by the sweep itself, but it is a sum- changes of opposite signs
+ * cancel, so a grid can look settled while parts of it still move. the norms of the change of the cells see
+ * every local change, but they need the grid as it was before the sweep, so a checked sweep copies the grid
+ * first. checking every K sweeps makes that copy (and the check) K times rarer, at the price of up to K - 1
+ * sweeps after the calculation was already over. the heat difference costs nothing to check, so skipping its
+ * checks would only add sweeps- it is checked after every sweep.
+ * the predictive policy checks the largest change of a cell, but measures how fast it contracts between two
+ * checks- the change of sweep k is about d * rate^k- and skips to half the way to the sweep it is predicted to
+ * fall below terminate, saving the copies of the sweeps in between.
+ * the counts of the check, the heat of the grid and the active tiles are all a round until terminate depends on
+ * besides the grid, so they are told to the progress function every K sweeps (to checkpoint the round), and a
+ * round that is resumed from them goes on as if it wasn't stopped.
+ * Input  : the grid and its heat around every sweep
+ * Process: copy the grid before a checked sweep, measure the change after it, schedule the next check
+ * Output : if the calculation is over, and the counts of the checks
+ */
+
+// ------------------------------ includes ------------------------------
+#include <string.h>
+#include "sweep.h"
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function finds out if the convergence check of a calculation copies the grid before a checked sweep
+ * @param options : the options of the calculation, with the policy
+ * @param n_iter : the number of iterations given- the check is only used when it's zero
+ * @return 1 if the grid is copied and 0 otherwise
+ */
+int needsGridCopy(const calc_options *options, unsigned int n_iter)
+{
+    return n_iter == 0 && options->convergence != CHECK_HEAT;
+}
+
+/**
+ * this function inits the convergence check of a calculation until terminate
+ * @param check : the check to init
+ * @param options : the options of the calculation, with the policy
+ * @param terminate : the termination value
+ * @param n_iter : the number of iterations given- the check is only used when it's zero
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param before : room for the copy of the grid (n * m cells), when needsGridCopy says it is copied
+ */
+void initConvergence(convergence_check *check, const calc_options *options, double terminate, unsigned int n_iter,
+                     size_t n, size_t m, double *before)
+{
+    check->policy = options->convergence;
+    check->checkEvery = options->convergence != CHECK_HEAT && options->check_every > 0 ? options->check_every : 1;
+    check->terminate = terminate;
+    check->n = n;
+    check->m = m;
+    check->sweeps = 0;
+    check->checks = 0;
+    check->nextCheck = check->checkEvery;
+    check->metric = 0;
+    check->lastMetric = -1;
+    check->lastCheck = 0;
+    check->before = needsGridCopy(options, n_iter) ? before : NULL;
+    check->onProgress = n_iter == 0 && options->progress_every > 0 ? options->on_progress : NULL;
+    check->progressContext = options->progress_context;
+    check->progressEvery = options->progress_every;
+    check->tiles = NULL;
+    check->isResumed = 0;
+    check->resumedHeat = 0;
+}
+
+/**
+ * this function makes the check go on from where a round was stopped
+ * @param check : the convergence check, right after initConvergence
+ * @param progress : where the round was stopped
+ * @param tiles : the active tiles of the round, right after resetTileTracker, or NULL
+ */
+void resumeConvergence(convergence_check *check, const round_progress *progress, tile_tracker *tiles)
+{
+    check->sweeps = progress->sweeps;
+    check->checks = progress->checks;
+    check->nextCheck = progress->next_check;
+    check->lastCheck = progress->last_check;
+    check->metric = progress->metric;
+    check->lastMetric = progress->last_metric;
+    check->isResumed = 1;
+    check->resumedHeat = progress->heat;
+    if (tiles != NULL && progress->active_tiles != NULL && progress->num_tiles == tiles->tileRows * tiles->tileCols)
+    {
+        memcpy(tiles->active, progress->active_tiles, progress->num_tiles * sizeof(unsigned char));
+    }
+}
+
+/**
+ * this function gives the heat of the grid a round starts from
+ * @param check : the convergence check of the round
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @return the heat of the grid, or the heat the round was stopped with if it is resumed (the engines that sum
+ * the heat by rows may sum it to other bits)
+ */
+double roundStartHeat(const convergence_check *check, const double *grid, size_t stride, size_t n, size_t m)
+{
+    return check->isResumed ? check->resumedHeat : getSumOfHeat(grid, stride, n, m);
+}
+
+/**
+ * this function copies the grid before a sweep that is checked with a norm
+ * @param check : the convergence check
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ */
+void prepareSweep(convergence_check *check, const double *grid, size_t stride)
+{
+    if (check->before == NULL || check->sweeps + 1 != check->nextCheck)
+    {
+        return;
+    }
+    size_t row;
+    for (row = 0; row < check->n; ++row)
+    {
+        memcpy(check->before + row * check->m, grid + row * stride, check->m * sizeof(double));
+    }
+}
+
+/**
+ * this function measures the change of the cells since prepareSweep copied them
+ * @param check : the convergence check
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @return the L2 norm of the changes for CHECK_L2_NORM, and the largest change of a cell otherwise (NaN if a cell
+ * is NaN)
+ */
+double measureChange(const convergence_check *check, const double *grid, size_t stride)
+{
+    double largest = 0, squares = 0;
+    size_t row, col;
+    for (row = 0; row < check->n; ++row)
+    {
+        const double *rowCells = grid + row * stride, *rowBefore = check->before + row * check->m;
+        for (col = 0; col < check->m; ++col)
+        {
+            double change = fabs(rowCells[col] - rowBefore[col]);
+            if (!(change <= largest))
+            { // NaN stays
+                largest = change;
+            }
+            squares += change * change;
+        }
+    }
+    return check->policy == CHECK_L2_NORM ? sqrt(squares) : largest;
+}
+
+/**
+ * this function predicts how many sweeps the largest change of a cell takes to fall below terminate, from its
+ * contraction between the last two checks
+ * @param check : the convergence check, right after a check
+ * @return the number of sweeps to the next check- half the prediction, between 1 and PREDICTION_LIMIT
+ */
+unsigned long predictSweeps(const convergence_check *check)
+{
+    if (check->lastMetric <= 0 || !(check->metric > 0) || check->metric >= check->lastMetric)
+    { // no contraction to measure yet (or it grows)- the regular interval
+        return check->checkEvery;
+    }
+    // the contraction of a single sweep
+    double rate = pow(check->metric / check->lastMetric, 1.0 / (double) (check->sweeps - check->lastCheck));
+    double predicted = log(check->terminate / check->metric) / log(rate) / 2;
+    if (!(predicted >= 1))
+    {
+        return 1;
+    }
+    return predicted < PREDICTION_LIMIT ? (unsigned long) predicted : PREDICTION_LIMIT;
+}
+
+/**
+ * this function tells the progress function where the round is
+ * @param check : the convergence check, after a sweep that didn't end the round
+ * @param grid : the strided grid of all the cells holding their values, after the sweep
+ * @param stride : the distance between two rows of the grid
+ * @param currHeat : the heat of the grid after the sweep
+ */
+void reportProgress(const convergence_check *check, const double *grid, size_t stride, double currHeat)
+{
+    round_progress progress;
+    progress.heat = currHeat;
+    progress.sweeps = check->sweeps;
+    progress.checks = check->checks;
+    progress.next_check = check->nextCheck;
+    progress.last_check = check->lastCheck;
+    progress.metric = check->metric;
+    progress.last_metric = check->lastMetric;
+    progress.active_tiles = check->tiles != NULL ? check->tiles->active : NULL;
+    progress.num_tiles = check->tiles != NULL ? check->tiles->tileRows * check->tiles->tileCols : 0;
+    check->onProgress(check->progressContext, grid, stride, check->n, check->m, &progress);
+}
+
+/**
+ * this function counts a sweep and checks the convergence if it's time (and tells the progress function where
+ * the round is, if it's time and the round isn't over)
+ * @param check : the convergence check
+ * @param grid : the strided grid of all the cells holding their values, after the sweep
+ * @param stride : the distance between two rows of the grid
+ * @param initialHeat : the heat of the grid before the sweep
+ * @param currHeat : the heat of the grid after the sweep
+ * @return 1 if the calculation is over and 0 otherwise
+ */
+int finishSweep(convergence_check *check, const double *grid, size_t stride, double initialHeat, double currHeat)
+{
+    if (++check->sweeps == check->nextCheck)
+    {
+        ++check->checks;
+        double lastMetric = check->metric;
+        check->metric = check->before != NULL ? measureChange(check, grid, stride) : fabs(currHeat - initialHeat);
+        if (!(check->metric >= check->terminate))
+        {
+            return 1;
+        }
+        if (check->policy == CHECK_PREDICTIVE)
+        {
+            check->lastMetric = check->checks > 1 ? lastMetric : -1;
+            check->nextCheck = check->sweeps + predictSweeps(check);
+            check->lastCheck = check->sweeps;
+        }
+        else
+        {
+            check->nextCheck = check->sweeps + check->checkEvery;
+        }
+    }
+    if (check->onProgress != NULL && check->sweeps % check->progressEvery == 0)
+    {
+        reportProgress(check, grid, stride, currHeat);
+    }
+    return 0;
+}
+
+/**
+ * this function adds the counts of the check to the report
+ * @param check : the convergence check
+ * @param report : the report, or NULL
+ */
+void endConvergence(convergence_check *check, convergence_report *report)
+{
+    if (report != NULL)
+    {
+        report->sweeps += check->sweeps;
+        report->checks += check->checks;
+    }
+    check->before = NULL;
+}
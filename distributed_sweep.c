@@ -0,0 +1,611 @@
+/**
+ * @file distributed_sweep.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * the distributed Jacobi engine of the calculator- the rows are split to bands between worker processes that
+ * exchange their boundary rows after every sweep
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * the threads of parallel_sweep.c share the whole grid, so the grid is limited to the memory of a single process
+ * and every thread reads the rows of its neighbors straight from it. here every worker process owns a band of
+ * rows- its last and next grid are allocated by the worker itself (in the memory of the worker), with a halo row
+ * above and below the band for the boundary rows of its neighbors.
+ * the workers talk through a mapping of shared memory, the transport of a single machine: after every sweep a
+ * worker publishes its first and last rows to its mailboxes and sums the heat of its rows into its slots, and
+ * after a barrier the first worker sums the heat of all the rows in their order (the reduction) and decides
+ * if the calculation is over. the mailboxes are double buffered by the parity of the sweep, so a worker never
+ * writes the rows its neighbors are still reading.
+ * the grid stays in the memory of the first worker (the calling process)- the other workers drop the pages of
+ * the grid the fork gave them once their band is loaded, and when the calculation is over they send their bands
+ * back through their mailboxes, GATHER_ROWS rows at a time, for the first worker to copy into the grid. so no
+ * process holds more than the grid and the two grids of its band. the pages are placed wherever the kernel puts
+ * them- there is no placement of the bands on NUMA nodes.
+ * the results are identical to the JACOBI scheme on a single process, with any number of workers.
+ * Input  : the parameters of the calculate function
+ * Process: Jacobi sweeps on a band of rows in every worker process
+ * Output : the heat difference in the last round
+ */
+
+// ------------------------------ includes ------------------------------
+#include <pthread.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "sweep.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * @brief the states of the start of the workers
+ */
+#define START_WAIT 0
+#define START_GO 1
+#define START_ABORT (-1)
+
+/**
+ * @brief the mailboxes of a worker- its first row and its last row
+ */
+#define FIRST_ROW 0
+#define LAST_ROW 1
+
+/**
+ * @brief the number of rows a worker sends back in a single exchange when the calculation is over- all of its
+ * mailboxes, of both parities
+ */
+#define GATHER_ROWS 4
+
+/**
+ * @brief the part of a distributed calculation in the shared memory
+ */
+typedef struct
+{
+    pthread_barrier_t barrier;
+    /** the workers tell when they are ready (or failed), then wait for the go (or for the abort) */
+    pthread_mutex_t startLock;
+    pthread_cond_t startChanged;
+    int startState;
+    unsigned int ready, failed;
+    /** the heat of the grid before and after the last sweep, and if the calculation is over */
+    double initialHeatAmount, currHeatAmount;
+    int done;
+} shared_header;
+
+/**
+ * @brief the state of a distributed calculation- its parameters, copied to every worker by the fork, and the
+ * shared memory
+ */
+typedef struct
+{
+    diff_func function;
+    /** the kernel of the built-in heat equation */
+    heat_row_kernel heatRow;
+    size_t n, m;
+    const unsigned char *sourceMask;
+    /** the convergence check, for n_iter zero (only the first worker's one counts) */
+    convergence_check *check;
+    unsigned int n_iter;
+    int isCyclic;
+    unsigned int numWorkers;
+    /** the shared memory and its size */
+    void *shared;
+    size_t sharedSize;
+    shared_header *header;
+    /** the heat sum of every row in the current sweep */
+    heat_sum *rowHeat;
+    /** the first and last rows of every worker for every parity of the sweep (2 * numWorkers * 2 rows of m) */
+    double *mailboxes;
+    /** the strided grid the bands are gathered to, in the memory of the first worker */
+    double *grid;
+    size_t stride;
+} distributed_state;
+
+/**
+ * @brief the band of rows of a single worker
+ */
+typedef struct
+{
+    distributed_state *state;
+    unsigned int index;
+    size_t firstRow, lastRow;
+    /** the band of the last sweep and the one the next sweep writes (strided, lastRow - firstRow rows) */
+    double *band, *nextBand;
+    size_t stride;
+} domain_band;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function lays out the shared memory of a distributed calculation (see calc_arena)
+ * @param state : the state of the calculation
+ * @param arena : the arena
+ */
+void layoutShared(distributed_state *state, calc_arena *arena)
+{
+    state->header = (shared_header *) arenaAlloc(arena, sizeof(shared_header));
+    state->rowHeat = (heat_sum *) arenaAlloc(arena, state->n * sizeof(heat_sum));
+    state->mailboxes = (double *) arenaAlloc(arena, 2 * state->numWorkers * 2 * state->m * sizeof(double));
+}
+
+/**
+ * this function gives a mailbox of a worker
+ * @param state : the state of the calculation
+ * @param parity : the parity of the sweep the rows are read in
+ * @param worker : the index of the worker
+ * @param row : FIRST_ROW or LAST_ROW
+ * @return the m cells of the mailbox
+ */
+double *mailbox(const distributed_state *state, unsigned int parity, unsigned int worker, int row)
+{
+    return state->mailboxes + ((parity * state->numWorkers + worker) * 2 + row) * state->m;
+}
+
+/**
+ * this function allocates the grids of a band and copies its rows of the grid into the first one
+ * @param band : the band, with its rows
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @return 0 on success and -1 if the memory couldn't be allocated
+ */
+int loadBand(domain_band *band, const double *grid, size_t stride)
+{
+    size_t rows = band->lastRow - band->firstRow, m = band->state->m, row, nextStride;
+    band->band = allocStridedGrid(rows, m, &band->stride);
+    band->nextBand = allocStridedGrid(rows, m, &nextStride);
+    if (band->band == NULL || band->nextBand == NULL)
+    {
+        freeStridedGrid(band->band, band->stride);
+        freeStridedGrid(band->nextBand, nextStride);
+        return -1;
+    }
+    for (row = 0; row < rows; ++row)
+    {
+        memcpy(band->band + row * band->stride, grid + (band->firstRow + row) * stride, m * sizeof(double));
+    }
+    return 0;
+}
+
+/**
+ * this function drops the pages a worker process got from the fork in the given range (only the pages that hold
+ * nothing else)- so the first worker, that keeps them, is the only one holding them
+ * @param start : the first byte of the range
+ * @param end : the byte after the range
+ */
+void dropPages(const void *start, const void *end)
+{
+    uintptr_t pageSize = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t first = ((uintptr_t) start + pageSize - 1) / pageSize * pageSize;
+    uintptr_t last = (uintptr_t) end / pageSize * pageSize;
+    if (last > first)
+    {
+        madvise((void *) first, last - first, MADV_DONTNEED);
+    }
+}
+
+/**
+ * this function drops the pages of the grid a worker process got from the fork once its band is loaded from
+ * them, and the pages of the source mask outside its band- so the first worker writes the gathered bands to the
+ * grid without copying its pages
+ * @param band : the band of the worker, loaded
+ * @param grid : the strided grid of all the cells holding their values (the copy of the fork)
+ * @param stride : the distance between two rows of the grid
+ */
+void dropForkedPages(const domain_band *band, const double *grid, size_t stride)
+{
+    const distributed_state *state = band->state;
+    dropPages(grid - stride, grid + (state->n + 1) * stride);
+    dropPages(state->sourceMask, state->sourceMask + band->firstRow * state->m);
+    dropPages(state->sourceMask + band->lastRow * state->m, state->sourceMask + state->n * state->m);
+}
+
+/**
+ * this function sends the bands of the workers back to the grid when the calculation is over- in every exchange
+ * every worker but the first copies the next GATHER_ROWS rows of its band to its mailboxes, and after a barrier
+ * the first worker copies them into the grid. the first worker copies its own band straight into the grid.
+ * @param band : the band of the worker
+ */
+void gatherBands(domain_band *band)
+{
+    distributed_state *state = band->state;
+    size_t m = state->m, maxRows = (state->n + state->numWorkers - 1) / state->numWorkers, offset, row;
+    unsigned int worker, slot;
+    for (offset = 0; offset < maxRows; offset += GATHER_ROWS)
+    {
+        for (slot = 0; band->index > 0 && slot < GATHER_ROWS; ++slot)
+        {
+            row = band->firstRow + offset + slot;
+            if (row < band->lastRow)
+            {
+                memcpy(mailbox(state, slot / 2, band->index, slot % 2),
+                       band->band + (row - band->firstRow) * band->stride, m * sizeof(double));
+            }
+        }
+        pthread_barrier_wait(&state->header->barrier);
+        for (worker = 1; band->index == 0 && worker < state->numWorkers; ++worker)
+        {
+            size_t firstRow = state->n * worker / state->numWorkers;
+            size_t lastRow = state->n * (worker + 1) / state->numWorkers;
+            for (slot = 0; slot < GATHER_ROWS && firstRow + offset + slot < lastRow; ++slot)
+            {
+                memcpy(state->grid + (firstRow + offset + slot) * state->stride,
+                       mailbox(state, slot / 2, worker, slot % 2), m * sizeof(double));
+            }
+        }
+        pthread_barrier_wait(&state->header->barrier);
+    }
+    for (row = band->firstRow; band->index == 0 && row < band->lastRow; ++row)
+    {
+        memcpy(state->grid + row * state->stride, band->band + (row - band->firstRow) * band->stride,
+               m * sizeof(double));
+    }
+}
+
+/**
+ * this function copies the boundary rows of the neighbors of a band into its halo, and for cyclic grids the
+ * wrapped columns of its rows. a band on the edge of a grid that isn't cyclic keeps the zeroed halo.
+ * @param band : the band
+ * @param parity : the parity of the sweep
+ */
+void exchangeHalo(domain_band *band, unsigned int parity)
+{
+    const distributed_state *state = band->state;
+    size_t rows = band->lastRow - band->firstRow, m = state->m, row;
+    if (band->index > 0 || state->isCyclic)
+    {
+        unsigned int above = band->index > 0 ? band->index - 1 : state->numWorkers - 1;
+        memcpy(band->band - band->stride, mailbox(state, parity, above, LAST_ROW), m * sizeof(double));
+    }
+    if (band->index + 1 < state->numWorkers || state->isCyclic)
+    {
+        unsigned int below = band->index + 1 < state->numWorkers ? band->index + 1 : 0;
+        memcpy(band->band + rows * band->stride, mailbox(state, parity, below, FIRST_ROW), m * sizeof(double));
+    }
+    if (state->isCyclic)
+    {
+        for (row = 0; row < rows; ++row)
+        {
+            double *rowCells = band->band + row * band->stride;
+            rowCells[-1] = rowCells[m - 1];
+            rowCells[m] = rowCells[0];
+        }
+    }
+}
+
+/**
+ * this function writes the next grid of a band in a Jacobi sweep, sums the heat of every row and publishes the
+ * first and last rows of the band for the next sweep
+ * @param band : the band
+ * @param parity : the parity of the next sweep
+ */
+void sweepBand(domain_band *band, unsigned int parity)
+{
+    distributed_state *state = band->state;
+    size_t rows = band->lastRow - band->firstRow, m = state->m, row;
+    for (row = 0; row < rows; ++row)
+    {
+        const double *rowCells = band->band + row * band->stride;
+        double *nextCells = band->nextBand + row * band->stride;
+        const unsigned char *rowMask = state->sourceMask + (band->firstRow + row) * m;
+        heat_sum *heat = &state->rowHeat[band->firstRow + row];
+        heat->sum = 0;
+        heat->compensation = 0;
+        if (state->function == heat_eqn)
+        {
+            jacobiHeatRow(state->heatRow, rowCells, nextCells, band->stride, rowMask, m, heat);
+        }
+        else
+        {
+            jacobiFunctionRow(state->function, rowCells, nextCells, band->stride, rowMask, m, heat);
+        }
+    }
+    double *lastBand = band->band;
+    band->band = band->nextBand;
+    band->nextBand = lastBand;
+    memcpy(mailbox(state, parity, band->index, FIRST_ROW), band->band, m * sizeof(double));
+    memcpy(mailbox(state, parity, band->index, LAST_ROW), band->band + (rows - 1) * band->stride,
+           m * sizeof(double));
+}
+
+/**
+ * this function sums the heat of the rows in their order, so the result doesn't depend on the bands
+ * @param state : the state of the calculation
+ * @return the heat of the grid after the sweep
+ */
+double reduceRowHeat(const distributed_state *state)
+{
+    size_t row;
+    double sum = 0, compensation = 0;
+    for (row = 0; row < state->n; ++row)
+    {
+        ADD_HEAT(sum, compensation, state->rowHeat[row].sum + state->rowHeat[row].compensation);
+    }
+    return sum + compensation;
+}
+
+/**
+ * this function is the loop every worker runs. the first worker also decides when the calculation is over.
+ * when it is, the bands are gathered to the grid.
+ * @param band : the band of the worker
+ */
+void runDomain(domain_band *band)
+{
+    distributed_state *state = band->state;
+    shared_header *header = state->header;
+    unsigned int iteration = 0;
+    for (;;)
+    {
+        exchangeHalo(band, iteration % 2);
+        sweepBand(band, (iteration + 1) % 2);
+        pthread_barrier_wait(&header->barrier);
+        ++iteration;
+        if (band->index == 0)
+        {
+            header->initialHeatAmount = header->currHeatAmount;
+            header->currHeatAmount = reduceRowHeat(state);
+            header->done = state->n_iter > 0 ? iteration >= state->n_iter
+                                             : finishSweep(state->check, NULL, 0, header->initialHeatAmount,
+                                                           header->currHeatAmount);
+        }
+        pthread_barrier_wait(&header->barrier);
+        if (header->done)
+        {
+            break;
+        }
+    }
+    gatherBands(band);
+}
+
+/**
+ * this function is the entry of a worker process- it loads its band (and drops the pages it doesn't need), tells
+ * it is ready and waits for the go, then runs its band. it never returns.
+ * @param band : the band of the worker
+ * @param grid : the strided grid of all the cells holding their values (the copy of the fork)
+ * @param stride : the distance between two rows of the grid
+ */
+void startDomain(domain_band *band, const double *grid, size_t stride)
+{
+    shared_header *header = band->state->header;
+    int loaded = loadBand(band, grid, stride) == 0;
+    dropForkedPages(band, grid, stride);
+    pthread_mutex_lock(&header->startLock);
+    if (loaded)
+    {
+        ++header->ready;
+    }
+    else
+    {
+        ++header->failed;
+    }
+    pthread_cond_broadcast(&header->startChanged);
+    while (header->startState == START_WAIT)
+    {
+        pthread_cond_wait(&header->startChanged, &header->startLock);
+    }
+    int startState = header->startState;
+    pthread_mutex_unlock(&header->startLock);
+    if (loaded && startState == START_GO)
+    {
+        runDomain(band);
+    }
+    _exit(0);
+}
+
+/**
+ * this function waits until all the started workers are ready (or failed) and releases them
+ * @param header : the shared part of the calculation
+ * @param numStarted : the number of worker processes started
+ * @param canRun : 1 if all the workers were started and the first one is ready, 0 otherwise
+ * @return START_GO if the workers run their bands and START_ABORT if they quit
+ */
+int releaseWorkers(shared_header *header, unsigned int numStarted, int canRun)
+{
+    pthread_mutex_lock(&header->startLock);
+    while (header->ready + header->failed < numStarted)
+    {
+        pthread_cond_wait(&header->startChanged, &header->startLock);
+    }
+    header->startState = canRun && header->failed == 0 ? START_GO : START_ABORT;
+    pthread_cond_broadcast(&header->startChanged);
+    int startState = header->startState;
+    pthread_mutex_unlock(&header->startLock);
+    return startState;
+}
+
+/**
+ * this function inits the barrier and the start state in the shared memory, for processes
+ * @param header : the shared part of the calculation
+ * @param numWorkers : the number of workers
+ * @return 0 on success and -1 otherwise
+ */
+int initSharedHeader(shared_header *header, unsigned int numWorkers)
+{
+    pthread_barrierattr_t barrierAttr;
+    pthread_mutexattr_t mutexAttr;
+    pthread_condattr_t condAttr;
+    int status = -1;
+    if (pthread_barrierattr_init(&barrierAttr) != 0)
+    {
+        return -1;
+    }
+    if (pthread_mutexattr_init(&mutexAttr) == 0)
+    {
+        if (pthread_condattr_init(&condAttr) == 0)
+        {
+            if (pthread_barrierattr_setpshared(&barrierAttr, PTHREAD_PROCESS_SHARED) == 0 &&
+                pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED) == 0 &&
+                pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED) == 0 &&
+                pthread_barrier_init(&header->barrier, &barrierAttr, numWorkers) == 0)
+            {
+                if (pthread_mutex_init(&header->startLock, &mutexAttr) != 0)
+                {
+                    pthread_barrier_destroy(&header->barrier);
+                }
+                else if (pthread_cond_init(&header->startChanged, &condAttr) != 0)
+                {
+                    pthread_mutex_destroy(&header->startLock);
+                    pthread_barrier_destroy(&header->barrier);
+                }
+                else
+                {
+                    status = 0;
+                }
+            }
+            pthread_condattr_destroy(&condAttr);
+        }
+        pthread_mutexattr_destroy(&mutexAttr);
+    }
+    pthread_barrierattr_destroy(&barrierAttr);
+    header->startState = START_WAIT;
+    header->ready = 0;
+    header->failed = 0;
+    header->done = 0;
+    return status;
+}
+
+/**
+ * this function maps the shared memory of a distributed calculation and lays it out
+ * @param state : the state of the calculation
+ * @return 0 on success and -1 if the memory couldn't be mapped or its barrier couldn't be made
+ */
+int mapShared(distributed_state *state)
+{
+    calc_arena arena;
+    initArena(&arena);
+    layoutShared(state, &arena);
+    state->sharedSize = arena.used;
+    state->shared = mmap(NULL, state->sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (state->shared == MAP_FAILED)
+    {
+        return -1;
+    }
+    arena.block = (char *) state->shared;
+    arena.size = state->sharedSize;
+    arena.used = 0;
+    layoutShared(state, &arena);
+    if (initSharedHeader(state->header, state->numWorkers) != 0)
+    {
+        munmap(state->shared, state->sharedSize);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * this function waits for the worker processes to exit
+ * @param workers : the ids of the worker processes
+ * @param numStarted : the number of worker processes
+ */
+void joinWorkers(const pid_t *workers, unsigned int numStarted)
+{
+    unsigned int i;
+    for (i = 0; i < numStarted; ++i)
+    {
+        while (waitpid(workers[i], NULL, 0) < 0 && errno == EINTR)
+        {
+        }
+    }
+}
+
+/**
+ * this function calculates the heat equation with Jacobi sweeps on worker processes, each owning a band of rows.
+ * a calculation that records statistics, checks a norm of the change or tells its progress needs the whole grid
+ * after every sweep, so it runs on the threads of calculateParallel instead, and so does a calculation whose
+ * workers couldn't be started- the results are identical.
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sourceMask : the source mask filled by markSources
+ * @param check : the convergence check, for n_iter zero
+ * @param n_iter : the number of iterations given
+ * @param is_cyclic : 1 if its cyclic and 0 if its not
+ * @param num_processes : the number of worker processes to split the rows between (at most one for every row)
+ * @param num_threads : the number of threads of the fallback
+ * @param simd : the widest instructions the kernel of the built-in heat equation may use
+ * @param stats : the statistics to record every sweep in, or NULL
+ * @return the heat difference in the last round (or the measure of the convergence check, for n_iter zero), or a
+ * negative value if the memory couldn't be allocated
+ */
+double calculateDistributed(diff_func function, double *grid, size_t stride, size_t n, size_t m,
+                            const unsigned char *sourceMask, convergence_check *check, unsigned int n_iter,
+                            int is_cyclic, unsigned int num_processes, unsigned int num_threads, simd_level simd,
+                            calc_stats *stats)
+{
+    distributed_state state = {function, selectHeatRowKernel(simd), n, m, sourceMask, check, n_iter, is_cyclic};
+    state.grid = grid;
+    state.stride = stride;
+    state.numWorkers = num_processes > n ? (unsigned int) n : num_processes;
+    if (state.numWorkers < 2 || stats != NULL ||
+        (n_iter == 0 && (check->before != NULL || check->onProgress != NULL)))
+    {
+        return calculateParallel(function, grid, stride, n, m, sourceMask, check, n_iter, is_cyclic, JACOBI,
+                                 num_threads, simd, stats);
+    }
+    domain_band *bands = (domain_band *) malloc(state.numWorkers * sizeof(domain_band));
+    pid_t *workers = (pid_t *) calloc(state.numWorkers, sizeof(pid_t));
+    if (bands == NULL || workers == NULL || mapShared(&state) != 0)
+    {
+        free(bands);
+        free(workers);
+        return calculateParallel(function, grid, stride, n, m, sourceMask, check, n_iter, is_cyclic, JACOBI,
+                                 num_threads, simd, stats);
+    }
+    unsigned int i, started;
+    for (i = 0; i < state.numWorkers; ++i)
+    { // split the rows evenly between the bands, and publish their first and last rows for the first sweep
+        bands[i].state = &state;
+        bands[i].index = i;
+        bands[i].firstRow = n * i / state.numWorkers;
+        bands[i].lastRow = n * (i + 1) / state.numWorkers;
+        memcpy(mailbox(&state, 0, i, FIRST_ROW), grid + bands[i].firstRow * stride, m * sizeof(double));
+        memcpy(mailbox(&state, 0, i, LAST_ROW), grid + (bands[i].lastRow - 1) * stride, m * sizeof(double));
+    }
+    state.header->currHeatAmount = roundStartHeat(check, grid, stride, n, m);
+    for (started = 1; started < state.numWorkers; ++started)
+    {
+        pid_t worker = fork();
+        if (worker < 0)
+        {
+            break;
+        }
+        if (worker == 0)
+        {
+            startDomain(&bands[started], grid, stride);
+        }
+        workers[started] = worker;
+    }
+    int loaded = loadBand(&bands[0], grid, stride) == 0; // after the forks, so the workers don't get its pages
+    int startState = releaseWorkers(state.header, started - 1, loaded && started == state.numWorkers);
+    if (startState == START_GO)
+    {
+        runDomain(&bands[0]);
+    }
+    joinWorkers(workers + 1, started - 1);
+    if (loaded)
+    {
+        freeStridedGrid(bands[0].band, bands[0].stride);
+        freeStridedGrid(bands[0].nextBand, bands[0].stride);
+    }
+    pthread_barrier_destroy(&state.header->barrier);
+    pthread_cond_destroy(&state.header->startChanged);
+    pthread_mutex_destroy(&state.header->startLock);
+    double initialHeatAmount = state.header->initialHeatAmount, currHeatAmount = state.header->currHeatAmount;
+    munmap(state.shared, state.sharedSize);
+    free(bands);
+    free(workers);
+    if (startState != START_GO)
+    { // not all the workers could start- run the whole grid on the threads of this process
+        return calculateParallel(function, grid, stride, n, m, sourceMask, check, n_iter, is_cyclic, JACOBI,
+                                 num_threads, simd, stats);
+    }
+    return n_iter > 0 ? fabs(currHeatAmount - initialHeatAmount) : check->metric;
+}
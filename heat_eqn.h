@@ -3,4 +3,18 @@
 
 double heat_eqn(double right, double top, double left, double bottom);
 
+/**
+ * The discrete form of the heat equation, defined in the header so that sweeps using the
+ * built-in stencil can inline it (heat_eqn is the same formula behind a function pointer).
+ */
+static inline double heatEqnStencil(double right, double top, double left, double bottom)
+{
+    /*
+     * For simplicity, we have set D = dt = dx = 1;
+     */
+    double dphiDx = right + left; // - 2 * cell
+    double dphiDy = top + bottom; // - 2 * cell
+    return (dphiDx + dphiDy) / 4; // + cell - cancels out.
+}
+
 #endif /* HEAT_EQN_H_ */
@@ -0,0 +1,339 @@
+/**
+ * @file multigrid.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * the multigrid engine of the calculator- V-cycles that reach the steady state of the heat equation
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * the steady state of the built-in heat equation is the solution of the discrete Laplace equation, where every
+ * free cell is the average of its neighbors. a Gauss-Seidel sweep damps the error between close cells fast, but
+ * the smooth error very slowly. a V-cycle smooths the grid with the regular sweep, moves the equation of the
+ * remaining error (the residual) to a grid of half the rows and columns, corrects it there the same way
+ * (recursively) and adds the correction back.
+ * every coarse cell covers 2x2 cells of the finer level. a coarse cell that covers a source point is pinned to
+ * a zero correction, so the source points keep their values on every level. a cyclic grid wraps on every level.
+ * Input  : the parameters of the calculate function
+ * Process: multigrid V-cycles
+ * Output : the heat difference in the last round
+ */
+
+// ------------------------------ includes ------------------------------
+#include <string.h>
+#include "sweep.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * the number of sweeps that smooth a level before and after its correction
+ */
+#define SMOOTHING_SWEEPS 2
+
+/**
+ * the number of sweeps that solve the coarsest level
+ */
+#define COARSEST_SWEEPS 50
+
+/**
+ * a level with fewer rows or columns than that is not coarsened any more
+ */
+#define MIN_COARSE_SIZE 3
+
+/**
+ * a constant correction (every fine cell gets the value of the coarse cell covering it) undershoots the smooth
+ * error, so the coarse equations are scaled up by this factor
+ */
+#define OVER_CORRECTION 1.5
+
+/**
+ * @brief a level of the multigrid hierarchy. the finest level is the grid itself, and every coarser level holds
+ * the correction of the level above it.
+ */
+typedef struct
+{
+    size_t n, m, stride;
+    /** the strided grid of the values of the level- the grid itself or the correction */
+    double *cells;
+    /** the residual restricted from the finer level (n * m in row major order, unused on the finest) */
+    double *rhs;
+    /** the cells pinned to their values (n * m in row major order) */
+    unsigned char *mask;
+} mg_level;
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function frees the coarse levels of the hierarchy (the finest one is owned by the caller)
+ * @param levels : the levels of the hierarchy
+ * @param numLevels : the number of levels
+ */
+void freeLevels(mg_level *levels, size_t numLevels)
+{
+    size_t i;
+    for (i = 1; i < numLevels; ++i)
+    {
+        freeStridedGrid(levels[i].cells, levels[i].stride);
+        free(levels[i].rhs);
+        free(levels[i].mask);
+    }
+    free(levels);
+}
+
+/**
+ * this function builds the hierarchy of levels under the grid- it halves the rows and columns until one of them
+ * is too small, and pins every coarse cell that covers a pinned cell.
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sourceMask : the source mask filled by markSources
+ * @param numLevels : a pointer for the number of levels
+ * @return the levels, or NULL if the allocation failed
+ */
+mg_level *buildLevels(double *grid, size_t stride, size_t n, size_t m, const unsigned char *sourceMask,
+                      size_t *numLevels)
+{
+    size_t count = 1, rows = n, cols = m;
+    while (rows >= MIN_COARSE_SIZE && cols >= MIN_COARSE_SIZE)
+    {
+        rows = (rows + 1) / 2;
+        cols = (cols + 1) / 2;
+        ++count;
+    }
+    mg_level *levels = (mg_level *) calloc(count, sizeof(mg_level));
+    if (levels == NULL)
+    {
+        return NULL;
+    }
+    levels[0].n = n;
+    levels[0].m = m;
+    levels[0].stride = stride;
+    levels[0].cells = grid;
+    levels[0].mask = (unsigned char *) sourceMask;
+    size_t i, row, col;
+    for (i = 1; i < count; ++i)
+    {
+        mg_level *fine = &levels[i - 1], *coarse = &levels[i];
+        coarse->n = (fine->n + 1) / 2;
+        coarse->m = (fine->m + 1) / 2;
+        coarse->cells = allocStridedGrid(coarse->n, coarse->m, &coarse->stride);
+        coarse->rhs = (double *) malloc(coarse->n * coarse->m * sizeof(double));
+        coarse->mask = (unsigned char *) calloc(coarse->n * coarse->m, sizeof(unsigned char));
+        if (coarse->cells == NULL || coarse->rhs == NULL || coarse->mask == NULL)
+        {
+            freeLevels(levels, i + 1);
+            return NULL;
+        }
+        for (row = 0; row < fine->n; ++row)
+        {
+            for (col = 0; col < fine->m; ++col)
+            {
+                coarse->mask[row / 2 * coarse->m + col / 2] |= fine->mask[row * fine->m + col];
+            }
+        }
+    }
+    *numLevels = count;
+    return levels;
+}
+
+/**
+ * this function sweeps the correction of a coarse level once- every free cell becomes the average of its
+ * neighbors plus its residual.
+ * @param level : the level to smooth
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ */
+void smoothCorrection(mg_level *level, int isCyclic)
+{
+    size_t row, col;
+    if (isCyclic)
+    {
+        wrapHalo(level->cells, level->stride, level->n, level->m);
+    }
+    for (row = 0; row < level->n; ++row)
+    {
+        double *rowCells = level->cells + row * level->stride;
+        const double *rowRhs = level->rhs + row * level->m;
+        const unsigned char *rowMask = level->mask + row * level->m;
+        for (col = 0; col < level->m; ++col)
+        {
+            if (!rowMask[col])
+            {
+                rowCells[col] = heatEqnStencil(rowCells[col + 1], rowCells[col + level->stride],
+                                               rowCells[col - 1], rowCells[col - level->stride]) + rowRhs[col];
+            }
+        }
+    }
+}
+
+/**
+ * this function smooths a level- with the regular sweep on the finest level and with smoothCorrection on the
+ * coarser ones.
+ * @param levels : the levels of the hierarchy
+ * @param depth : the index of the level to smooth
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @param sweeps : the number of sweeps
+ * @return the heat of the grid after the last sweep (only on the finest level)
+ */
+double smoothLevel(mg_level *levels, size_t depth, int isCyclic, int sweeps)
+{
+    mg_level *level = &levels[depth];
+    double heat = 0;
+    int i;
+    for (i = 0; i < sweeps; ++i)
+    {
+        if (depth == 0)
+        {
+            heat = updateAllValues(heat_eqn, level->cells, level->stride, level->n, level->m, isCyclic,
+                                   level->mask, 1);
+        }
+        else
+        {
+            smoothCorrection(level, isCyclic);
+        }
+    }
+    return heat;
+}
+
+/**
+ * this function moves the residual of a level to the right hand side of the coarser level. summing the
+ * equations of the 2x2 cells a coarse cell covers gives twice the coarse equation, so its residual is twice
+ * the average of the residuals it covers (times OVER_CORRECTION).
+ * @param fine : the level to restrict
+ * @param coarse : the level under it
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @param isFinest : if the fine level is the grid itself (with no right hand side)
+ */
+void restrictResidual(mg_level *fine, mg_level *coarse, int isCyclic, int isFinest)
+{
+    size_t row, col;
+    if (isCyclic)
+    {
+        wrapHalo(fine->cells, fine->stride, fine->n, fine->m);
+    }
+    memset(coarse->rhs, 0, coarse->n * coarse->m * sizeof(double));
+    for (row = 0; row < fine->n; ++row)
+    {
+        const double *rowCells = fine->cells + row * fine->stride;
+        const unsigned char *rowMask = fine->mask + row * fine->m;
+        double *coarseRhs = coarse->rhs + row / 2 * coarse->m;
+        size_t rowsCovered = row / 2 * 2 + 1 < fine->n ? 2 : 1;
+        for (col = 0; col < fine->m; ++col)
+        {
+            if (rowMask[col])
+            {
+                continue;
+            }
+            double residual = heatEqnStencil(rowCells[col + 1], rowCells[col + fine->stride], rowCells[col - 1],
+                                             rowCells[col - fine->stride]) - rowCells[col];
+            if (!isFinest)
+            {
+                residual += fine->rhs[row * fine->m + col];
+            }
+            size_t colsCovered = col / 2 * 2 + 1 < fine->m ? 2 : 1;
+            coarseRhs[col / 2] += residual * 2 * OVER_CORRECTION / (rowsCovered * colsCovered);
+        }
+    }
+}
+
+/**
+ * this function adds the correction of the coarse level to the free cells of the finer level it covers
+ * @param fine : the level to correct
+ * @param coarse : the level under it
+ */
+void prolongCorrection(mg_level *fine, const mg_level *coarse)
+{
+    size_t row, col;
+    for (row = 0; row < fine->n; ++row)
+    {
+        double *rowCells = fine->cells + row * fine->stride;
+        const unsigned char *rowMask = fine->mask + row * fine->m;
+        const double *correction = coarse->cells + row / 2 * coarse->stride;
+        for (col = 0; col < fine->m; ++col)
+        {
+            if (!rowMask[col])
+            {
+                rowCells[col] += correction[col / 2];
+            }
+        }
+    }
+}
+
+/**
+ * this function runs a V-cycle from the given level down
+ * @param levels : the levels of the hierarchy
+ * @param numLevels : the number of levels
+ * @param depth : the index of the level the cycle starts at
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @return the heat of the grid after the cycle (only on the finest level)
+ */
+double runVCycle(mg_level *levels, size_t numLevels, size_t depth, int isCyclic)
+{
+    mg_level *level = &levels[depth];
+    if (depth + 1 == numLevels)
+    {
+        return smoothLevel(levels, depth, isCyclic, COARSEST_SWEEPS);
+    }
+    smoothLevel(levels, depth, isCyclic, SMOOTHING_SWEEPS);
+    mg_level *coarse = &levels[depth + 1];
+    restrictResidual(level, coarse, isCyclic, depth == 0);
+    size_t row;
+    for (row = 0; row < coarse->n; ++row)
+    { // the correction starts from zero
+        memset(coarse->cells + row * coarse->stride, 0, coarse->m * sizeof(double));
+    }
+    runVCycle(levels, numLevels, depth + 1, isCyclic);
+    prolongCorrection(level, coarse);
+    return smoothLevel(levels, depth, isCyclic, SMOOTHING_SWEEPS);
+}
+
+/**
+ * this function calculates the steady state of the heat equation with multigrid V-cycles. a round is a whole
+ * V-cycle, and the heat difference is the change of the heat of the grid in the cycle.
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sourceMask : the source mask filled by markSources
+ * @param check : the convergence check, for n_iter zero
+ * @param n_iter : the number of V-cycles given
+ * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic the halo holds the wrapped neighbors
+ * @param stats : the statistics to record every V-cycle in, or NULL
+ * @return the heat difference in the last round (or the measure of the convergence check, for n_iter zero), or a
+ * negative value if the memory couldn't be allocated
+ */
+double calculateMultigrid(double *grid, size_t stride, size_t n, size_t m, const unsigned char *sourceMask,
+                          convergence_check *check, unsigned int n_iter, int is_cyclic, calc_stats *stats)
+{
+    size_t numLevels;
+    mg_level *levels = buildLevels(grid, stride, n, m, sourceMask, &numLevels);
+    if (levels == NULL)
+    {
+        return -1;
+    }
+    double initialHeatAmount = roundStartHeat(check, grid, stride, n, m);
+    double currHeatAmount = initialHeatAmount;
+    unsigned int cycles = 0;
+    do
+    {
+        double start = stats != NULL ? statsSeconds() : 0;
+        if (n_iter == 0)
+        {
+            prepareSweep(check, grid, stride);
+        }
+        initialHeatAmount = currHeatAmount;
+        currHeatAmount = runVCycle(levels, numLevels, 0, is_cyclic);
+        ++cycles;
+        if (stats != NULL)
+        {
+            recordSweep(stats, heat_eqn, grid, stride, n, m, sourceMask, is_cyclic, 1, start, statsSeconds(),
+                        initialHeatAmount, currHeatAmount);
+        }
+    } while (n_iter > 0 ? cycles < n_iter : !finishSweep(check, grid, stride, initialHeatAmount, currHeatAmount));
+    freeLevels(levels, numLevels);
+    return n_iter > 0 ? fabs(currHeatAmount - initialHeatAmount) : check->metric;
+}
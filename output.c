@@ -0,0 +1,409 @@
+/**
+ * @file output.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * the output stage of the program- writes the rounds of a calculation in the text format of printf, fast, or as
+ * binary snapshots
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * printing a grid with a printf call for every cell spends most of the time parsing the format and locking the
+ * stream. the writer formats the cells itself into a large buffer and writes the buffer with a single write call
+ * when it is full or the round ends.
+ * a cell is scaled by 10^4 and rounded to an integer, then its digits are written. fma gives the exact rounding
+ * error of the scaling, so even the values that fall exactly in the middle after the scaling are rounded as
+ * printf rounds them (the exact decimal value of the double, ties to even). values too large for the fast path,
+ * infinities and NaN are formatted by snprintf.
+ * a binary snapshot isn't formatted at all- its header and the rows of the grid are handed to writev as they are
+ * in memory (the halo between the rows is skipped), so writing it costs as much as copying the grid. only a big
+ * endian host copies the cells, to swap their bytes.
+ * Input  : a grid and the result of a round
+ * Process: format the cells
+ * Output : the text of the round, identical to printf("%lf\n") and printf("%2.4lf,"), or its binary snapshot
+ */
+
+// ------------------------------ includes ------------------------------
+#include <stdio.h>
+#include <math.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "output.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * the scale that moves the 4 digits after the decimal point of a cell to its integer part
+ */
+#define CELL_SCALE 10000
+
+/**
+ * the number of digits after the decimal point of a cell
+ */
+#define CELL_DIGITS 4
+
+/**
+ * cells at least that large are formatted by snprintf- below it the scaled cell fits exactly in a long long and
+ * its rounding error is far below half a unit
+ */
+#define FAST_FORMAT_LIMIT 1e9
+
+/**
+ * the separator after every cell
+ */
+#define CELL_SEPARATOR ','
+
+/**
+ * the number of buffers handed to a single writev call (IOV_MAX on linux)
+ */
+#define MAX_IOVECS 1024
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function writes the given bytes to the file descriptor, retrying the partial and interrupted writes
+ * @param fd : the file descriptor
+ * @param data : the bytes to write
+ * @param length : the number of bytes
+ * @return 0 on success and -1 if the write failed
+ */
+int writeAll(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        data += written;
+        length -= (size_t) written;
+    }
+    return 0;
+}
+
+/**
+ * this function writes the buffer of the writer and empties it
+ * @param writer : the writer
+ * @return 0 on success and -1 if the write failed
+ */
+int flushGridWriter(grid_writer *writer)
+{
+    int status = writeAll(writer->fd, writer->buffer, writer->used);
+    writer->used = 0;
+    return status;
+}
+
+/**
+ * this function makes sure the buffer of the writer has room for another cell, flushing it if needed
+ * @param writer : the writer
+ * @return 0 on success and -1 if the write failed
+ */
+int reserveCell(grid_writer *writer)
+{
+    if (writer->used + MAX_CELL_TEXT > OUTPUT_BUFFER_SIZE)
+    {
+        return flushGridWriter(writer);
+    }
+    return 0;
+}
+
+/**
+ * this function checks if the host stores numbers little endian, as the binary snapshots do
+ * @return 1 for a little endian host and 0 otherwise
+ */
+int isLittleEndian(void)
+{
+    const uint16_t one = 1;
+    return *(const unsigned char *) &one == 1;
+}
+
+/**
+ * this function opens a writer of the given format to the given file descriptor
+ * @param writer : the writer to open
+ * @param format : the format of the output
+ * @param fd : the file descriptor
+ * @return 0 on success and -1 if the buffer couldn't be allocated
+ */
+int openGridWriter(grid_writer *writer, output_format format, int fd)
+{
+    writer->format = format;
+    writer->fd = fd;
+    writer->used = 0;
+    writer->buffer = NULL;
+    if (format == CSV_OUTPUT || !isLittleEndian())
+    {
+        writer->buffer = (char *) malloc(OUTPUT_BUFFER_SIZE);
+        if (writer->buffer == NULL)
+        {
+            return -1;
+        }
+    }
+    fflush(stdout); // whatever was printed before goes first
+    return 0;
+}
+
+/**
+ * this function frees the buffer of a writer
+ * @param writer : the writer to close
+ */
+void closeGridWriter(grid_writer *writer)
+{
+    free(writer->buffer);
+    writer->buffer = NULL;
+}
+
+/**
+ * this function writes the text of printf("%2.4lf,", value)
+ * @param value : the value of the cell
+ * @param text : the place for the text, with room for MAX_CELL_TEXT bytes
+ * @return the length of the text
+ */
+size_t formatCell(double value, char *text)
+{
+    if (!(fabs(value) < FAST_FORMAT_LIMIT))
+    { // large, infinite or NaN
+        return (size_t) snprintf(text, MAX_CELL_TEXT, "%2.4lf,", value);
+    }
+    double scaled = value * CELL_SCALE;
+    double error = fma(value, CELL_SCALE, -scaled); // the exact product is scaled + error
+    double rounded = nearbyint(scaled); // ties to even
+    double fraction = scaled - rounded;
+    if (fraction == 0.5 && error > 0)
+    { // the exact product is above the middle
+        rounded += 1;
+    }
+    else if (fraction == -0.5 && error < 0)
+    { // the exact product is below the middle
+        rounded -= 1;
+    }
+    unsigned long long units = (unsigned long long) fabs(rounded);
+    unsigned long long integerPart = units / CELL_SCALE;
+    unsigned int fractionPart = (unsigned int) (units % CELL_SCALE);
+    char digits[24];
+    size_t numDigits = 0, length = 0;
+    if (signbit(value))
+    { // printf keeps the sign of the negative values that round to zero
+        text[length++] = '-';
+    }
+    do
+    {
+        digits[numDigits++] = (char) ('0' + integerPart % 10);
+        integerPart /= 10;
+    } while (integerPart > 0);
+    while (numDigits > 0)
+    {
+        text[length++] = digits[--numDigits];
+    }
+    text[length++] = '.';
+    int i;
+    for (i = CELL_DIGITS - 1; i >= 0; --i)
+    {
+        text[length + i] = (char) ('0' + fractionPart % 10);
+        fractionPart /= 10;
+    }
+    length += CELL_DIGITS;
+    text[length++] = CELL_SEPARATOR;
+    return length;
+}
+
+/**
+ * this function writes the text of a round- the result and then the grid, and flushes it
+ * @param writer : the writer
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param result : the result of the calculate function
+ * @return 0 on success and -1 if the write failed
+ */
+int writeCsvRound(grid_writer *writer, const double *grid, size_t stride, size_t n, size_t m, double result)
+{
+    size_t row, col;
+    if (reserveCell(writer) != 0)
+    {
+        return -1;
+    }
+    writer->used += (size_t) snprintf(writer->buffer + writer->used, MAX_CELL_TEXT, "%lf\n", result);
+    for (row = 0; row < n; ++row)
+    {
+        const double *rowCells = grid + row * stride;
+        for (col = 0; col < m; ++col)
+        {
+            if (reserveCell(writer) != 0)
+            {
+                return -1;
+            }
+            writer->used += formatCell(rowCells[col], writer->buffer + writer->used);
+        }
+        writer->buffer[writer->used++] = '\n'; // reserveCell left room for it
+    }
+    return flushGridWriter(writer);
+}
+
+/**
+ * this function writes the given buffers to the file descriptor, retrying the partial and interrupted writes
+ * @param fd : the file descriptor
+ * @param buffers : the buffers to write (changed by the partial writes)
+ * @param count : the number of buffers
+ * @return 0 on success and -1 if the write failed
+ */
+int writevAll(int fd, struct iovec *buffers, int count)
+{
+    while (count > 0)
+    {
+        ssize_t written = writev(fd, buffers, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        while (count > 0 && (size_t) written >= buffers->iov_len)
+        { // skip the buffers that were written whole
+            written -= (ssize_t) buffers->iov_len;
+            ++buffers;
+            --count;
+        }
+        if (count > 0)
+        {
+            buffers->iov_base = (char *) buffers->iov_base + written;
+            buffers->iov_len -= (size_t) written;
+        }
+    }
+    return 0;
+}
+
+/**
+ * this function reverses the bytes of the given 8 byte values in place
+ * @param values : the values
+ * @param count : the number of values
+ */
+void swapBytes(void *values, size_t count)
+{
+    unsigned char *bytes = (unsigned char *) values;
+    size_t i;
+    int j;
+    for (i = 0; i < count; ++i, bytes += sizeof(uint64_t))
+    {
+        for (j = 0; j < (int) sizeof(uint64_t) / 2; ++j)
+        {
+            unsigned char byte = bytes[j];
+            bytes[j] = bytes[sizeof(uint64_t) - 1 - j];
+            bytes[sizeof(uint64_t) - 1 - j] = byte;
+        }
+    }
+}
+
+/**
+ * this function writes a binary snapshot on a big endian host- it copies the cells to the buffer of the writer
+ * to swap their bytes
+ * @param writer : the writer
+ * @param header : the header of the snapshot (in the byte order of the host)
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @return 0 on success and -1 if the write failed
+ */
+int writeSwappedSnapshot(grid_writer *writer, snapshot_header *header, const double *grid, size_t stride, size_t n,
+                         size_t m)
+{
+    const size_t capacity = OUTPUT_BUFFER_SIZE / sizeof(double);
+    size_t row, col, count;
+    swapBytes(&header->rows, 1);
+    swapBytes(&header->cols, 1);
+    swapBytes(&header->result, 1);
+    if (writeAll(writer->fd, (const char *) header, sizeof(snapshot_header)) != 0)
+    {
+        return -1;
+    }
+    for (row = 0; row < n; ++row)
+    {
+        for (col = 0; col < m; col += count)
+        {
+            count = m - col < capacity ? m - col : capacity;
+            memcpy(writer->buffer, grid + row * stride + col, count * sizeof(double));
+            swapBytes(writer->buffer, count);
+            if (writeAll(writer->fd, writer->buffer, count * sizeof(double)) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * this function writes the binary snapshot of a round- the header and the rows of the grid straight from it
+ * @param writer : the writer
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param result : the result of the calculate function
+ * @return 0 on success and -1 if the write failed
+ */
+int writeRawRound(grid_writer *writer, const double *grid, size_t stride, size_t n, size_t m, double result)
+{
+    snapshot_header header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LENGTH);
+    header.rows = n;
+    header.cols = m;
+    header.result = result;
+    if (!isLittleEndian())
+    {
+        return writeSwappedSnapshot(writer, &header, grid, stride, n, m);
+    }
+    struct iovec buffers[MAX_IOVECS];
+    buffers[0].iov_base = &header;
+    buffers[0].iov_len = sizeof(snapshot_header);
+    int count = 1;
+    size_t row;
+    for (row = 0; row < n; ++row)
+    {
+        if (count == MAX_IOVECS)
+        {
+            if (writevAll(writer->fd, buffers, count) != 0)
+            {
+                return -1;
+            }
+            count = 0;
+        }
+        buffers[count].iov_base = (void *) (grid + row * stride);
+        buffers[count].iov_len = m * sizeof(double);
+        ++count;
+    }
+    return writevAll(writer->fd, buffers, count);
+}
+
+/**
+ * this function writes a round in the format of the writer
+ * @param writer : the writer
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param result : the result of the calculate function
+ * @return 0 on success and -1 if the write failed
+ */
+int writeRound(grid_writer *writer, const double *grid, size_t stride, size_t n, size_t m, double result)
+{
+    if (writer->format == RAW_OUTPUT)
+    {
+        return writeRawRound(writer, grid, stride, n, m, result);
+    }
+    return writeCsvRound(writer, grid, stride, n, m, result);
+}
@@ -0,0 +1,153 @@
+/*
+ * output.h
+ *
+ * The output stage of the program- writes the rounds of a calculation as text or as binary snapshots.
+ */
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/**
+ * The number of bytes a grid_writer collects before it writes them.
+ */
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/**
+ * The longest text of a single cell ("%2.4lf," of -DBL_MAX is 316 bytes).
+ */
+#define MAX_CELL_TEXT 320
+
+/**
+ * The first bytes of every binary snapshot.
+ */
+#define SNAPSHOT_MAGIC "HEATSNAP"
+
+/**
+ * The length of SNAPSHOT_MAGIC (without the terminating null).
+ */
+#define SNAPSHOT_MAGIC_LENGTH 8
+
+/**
+ * The header of a binary snapshot. It is followed by rows * cols doubles- the grid in row major order. All the
+ * fields and the cells are little endian, and a file may hold any number of snapshots one after the other.
+ */
+typedef struct
+{
+    char magic[SNAPSHOT_MAGIC_LENGTH];
+    uint64_t rows, cols;
+    /** the result of the round (the heat difference) */
+    double result;
+} snapshot_header;
+
+/**
+ * The formats of the output.
+ */
+typedef enum
+{
+    /** the result in "%lf\n", then every row of the grid as its cells in "%2.4lf," and a new line */
+    CSV_OUTPUT,
+    /** a binary snapshot (snapshot_header and the cells) for every round */
+    RAW_OUTPUT
+} output_format;
+
+/**
+ * A writer of the rounds of a calculation to a file descriptor.
+ */
+typedef struct
+{
+    output_format format;
+    int fd;
+    /** the text of CSV_OUTPUT, or the byte swapped cells of RAW_OUTPUT on a big endian host */
+    char *buffer;
+    size_t used;
+} grid_writer;
+
+/**
+ * Opens a writer of the given format to the given file descriptor. Returns 0 on success and -1 if the buffer
+ * couldn't be allocated.
+ */
+int openGridWriter(grid_writer *writer, output_format format, int fd);
+
+/**
+ * Writes a round- the result and the grid (a strided grid, see allocStridedGrid). Returns 0 on success and -1
+ * if the write failed.
+ */
+int writeRound(grid_writer *writer, const double *grid, size_t stride, size_t n, size_t m, double result);
+
+/**
+ * Frees the buffer of a writer (everything written is already flushed, the file descriptor stays open).
+ */
+void closeGridWriter(grid_writer *writer);
+
+/**
+ * Returns 1 if the host stores numbers little endian, as the binary files do, and 0 otherwise.
+ */
+int isLittleEndian(void);
+
+/**
+ * Writes the text of printf("%2.4lf,", value) to text, which has room for MAX_CELL_TEXT bytes, and returns its
+ * length (no terminating null).
+ */
+size_t formatCell(double value, char *text);
+
+/**
+ * A writer thread in front of a grid_writer- the rounds are copied to a ring of snapshot buffers and written by
+ * the thread while the calculation goes on. When all the buffers wait to be written, the next round waits for
+ * one of them to be free.
+ */
+typedef struct
+{
+    grid_writer *writer;
+    size_t n, m, depth;
+    /** depth snapshots of n * m cells in row major order, and their results */
+    double *cells, *results;
+    /** the oldest snapshot that waits to be written, and the number of waiting snapshots */
+    size_t head, count;
+    int closing, failed;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    /** the number of rounds, the time the thread spent writing, the time the rounds waited for a free buffer and
+     * the time the close waited for the last rounds to be written */
+    unsigned long rounds;
+    double writeSeconds, stallSeconds, drainSeconds;
+} async_writer;
+
+/**
+ * Opens a writer thread of depth snapshot buffers of n * m cells in front of the given writer. Returns 0 on
+ * success and -1 if the buffers or the thread couldn't be created.
+ */
+int openAsyncWriter(async_writer *async, grid_writer *writer, size_t n, size_t m, size_t depth);
+
+/**
+ * Copies a round to a free snapshot buffer (waiting for one if needed) and queues it. Returns 0 on success and
+ * -1 if writing an earlier round failed.
+ */
+int submitRound(async_writer *async, const double *grid, size_t stride, double result);
+
+/**
+ * Waits for the queued rounds to be written, leaving the thread running. Returns 0 on success and -1 if a write
+ * failed.
+ */
+int drainAsyncWriter(async_writer *async);
+
+/**
+ * Waits for the queued rounds to be written and stops the thread. Returns 0 on success and -1 if a write failed.
+ */
+int closeAsyncWriter(async_writer *async);
+
+/**
+ * Prints the timing summary of a writer thread to stderr- how much of the writing overlapped the calculation,
+ * which took solveSeconds.
+ */
+void reportAsyncWriter(const async_writer *async, double solveSeconds);
+
+/**
+ * Returns the time in seconds of a monotonic clock.
+ */
+double currentSeconds(void);
+
+#endif /* OUTPUT_H */
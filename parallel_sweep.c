@@ -0,0 +1,448 @@
+/**
+ * @file parallel_sweep.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * the parallel engines of the calculator- red-black and Jacobi sweeps, with the rows split between a pool of
+ * threads
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * red-black: a cell with an even row + column is red and the others are black. all the neighbors of a red cell
+ * are black and the other way around, so all the cells of one color can be updated at once. the wrapped
+ * neighbors of a cyclic grid are copied to the halo when a color begins, so with an odd number of rows or
+ * columns the same colored cells on the two sides of the wrap don't race.
+ * Jacobi: every sweep reads the grid of the last sweep and writes a second grid, then the two are swapped.
+ * with the built-in heat equation the rows are written by the vectorized kernels of simd_kernels.c.
+ * the rows are split to bands, one band for every thread. the results don't depend on the number of threads.
+ * Input  : the parameters of the calculate function
+ * Process: red-black or Jacobi sweeps on a pool of threads
+ * Output : the heat difference in the last round
+ */
+
+// ------------------------------ includes ------------------------------
+#include <pthread.h>
+#include <string.h>
+#include "sweep.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * @brief the states of the start of the pool
+ */
+#define START_WAIT 0
+#define START_GO 1
+#define START_ABORT (-1)
+
+/**
+ * @brief the colors of the cells
+ */
+#define RED 0
+#define BLACK 1
+
+/**
+ * @brief the state of a parallel calculation shared by all the threads of the pool
+ */
+typedef struct
+{
+    iteration_scheme scheme;
+    diff_func function;
+    /** the kernel of the built-in heat equation for Jacobi sweeps */
+    heat_row_kernel heatRow;
+    /** the grid of the last sweep, and the one the next Jacobi sweep writes */
+    double *grid, *nextGrid;
+    size_t stride, n, m;
+    const unsigned char *sourceMask;
+    /** the convergence check, for n_iter zero */
+    convergence_check *check;
+    unsigned int n_iter;
+    int isCyclic;
+    unsigned int numThreads;
+    /** the heat sum of every row in the current sweep */
+    heat_sum *rowHeat;
+    pthread_barrier_t barrier;
+    /** the threads of the pool wait for the go (or for the abort, if not all of them started) */
+    pthread_mutex_t startLock;
+    pthread_cond_t startChanged;
+    int startState;
+    /** the heat of the grid before and after the last sweep, and if the calculation is over */
+    double initialHeatAmount, currHeatAmount;
+    int done;
+    /** the statistics to record every sweep in (by the first band's thread), or NULL, and when the sweep began */
+    calc_stats *stats;
+    double sweepStart;
+} parallel_state;
+
+/**
+ * @brief the part of the calculation a single thread of the pool is in charge of
+ */
+typedef struct
+{
+    parallel_state *state;
+    size_t firstRow, lastRow;
+} parallel_band;
+
+// ------------------------------ functions -----------------------------
+
+DEFINE_RUN_KERNEL(updateFunctionCells, function, 2)
+
+DEFINE_RUN_KERNEL(updateHeatCells, heatEqnStencil, 2)
+
+/**
+ * this function writes a row of the next grid of a Jacobi sweep from the cells of the last grid with the given
+ * function, and adds the new values to the heat sum. the source points keep their values.
+ * @param function : the function that calculates the new value of the cell
+ * @param rowCells : the first cell of the row in the last grid
+ * @param nextCells : the first cell of the row in the next grid
+ * @param stride : the distance between two rows of the grids
+ * @param rowMask : the source mask of the row
+ * @param m : the number of cells in the row
+ * @param heat : the heat sum of the row
+ */
+void jacobiFunctionRow(diff_func function, const double *rowCells, double *nextCells, size_t stride,
+                       const unsigned char *rowMask, size_t m, heat_sum *heat)
+{
+    size_t col;
+    double sum = heat->sum, compensation = heat->compensation;
+    for (col = 0; col < m; ++col)
+    {
+        nextCells[col] = rowMask[col] ? rowCells[col]
+                                      : function(rowCells[col + 1], rowCells[col + stride], rowCells[col - 1],
+                                                 rowCells[col - stride]);
+        ADD_HEAT(sum, compensation, nextCells[col]);
+    }
+    heat->sum = sum;
+    heat->compensation = compensation;
+}
+
+/**
+ * this function writes a row of the next grid of a Jacobi sweep with the (vectorized) kernel of the built-in
+ * heat equation, then puts back the values of the source points and adds the new values to the heat sum.
+ * @param heatRow : the kernel of the heat equation
+ * @param rowCells : the first cell of the row in the last grid
+ * @param nextCells : the first cell of the row in the next grid
+ * @param stride : the distance between two rows of the grids
+ * @param rowMask : the source mask of the row
+ * @param m : the number of cells in the row
+ * @param heat : the heat sum of the row
+ */
+void jacobiHeatRow(heat_row_kernel heatRow, const double *rowCells, double *nextCells, size_t stride,
+                   const unsigned char *rowMask, size_t m, heat_sum *heat)
+{
+    size_t col;
+    double sum = heat->sum, compensation = heat->compensation;
+    heatRow(rowCells, nextCells, stride, m);
+    for (col = 0; col < m; ++col)
+    {
+        if (rowMask[col])
+        {
+            nextCells[col] = rowCells[col];
+        }
+        ADD_HEAT(sum, compensation, nextCells[col]);
+    }
+    heat->sum = sum;
+    heat->compensation = compensation;
+}
+
+/**
+ * this function updates the cells of one color in a band of rows, and adds them to the heat sums of their rows
+ * @param state : the state of the calculation
+ * @param firstRow : the first row of the band
+ * @param lastRow : the row after the last row of the band
+ * @param color : the color to update
+ */
+void updateColor(parallel_state *state, size_t firstRow, size_t lastRow, int color)
+{
+    size_t row;
+    for (row = firstRow; row < lastRow; ++row)
+    {
+        double *rowCells = state->grid + row * state->stride;
+        const unsigned char *rowMask = state->sourceMask + row * state->m;
+        size_t firstCol = (row + color) % 2;
+        if (color == RED)
+        { // red is the first color of the sweep
+            state->rowHeat[row].sum = 0;
+            state->rowHeat[row].compensation = 0;
+        }
+        if (state->function == heat_eqn)
+        {
+            updateHeatCells(state->function, rowCells, state->stride, rowMask, firstCol, state->m,
+                            &state->rowHeat[row]);
+        }
+        else
+        {
+            updateFunctionCells(state->function, rowCells, state->stride, rowMask, firstCol, state->m,
+                                &state->rowHeat[row]);
+        }
+    }
+}
+
+/**
+ * this function writes a band of rows of the next grid of a Jacobi sweep, and sums the heat of every row
+ * @param state : the state of the calculation
+ * @param firstRow : the first row of the band
+ * @param lastRow : the row after the last row of the band
+ */
+void updateJacobi(parallel_state *state, size_t firstRow, size_t lastRow)
+{
+    size_t row;
+    for (row = firstRow; row < lastRow; ++row)
+    {
+        const double *rowCells = state->grid + row * state->stride;
+        double *nextCells = state->nextGrid + row * state->stride;
+        const unsigned char *rowMask = state->sourceMask + row * state->m;
+        state->rowHeat[row].sum = 0;
+        state->rowHeat[row].compensation = 0;
+        if (state->function == heat_eqn)
+        {
+            jacobiHeatRow(state->heatRow, rowCells, nextCells, state->stride, rowMask, state->m,
+                          &state->rowHeat[row]);
+        }
+        else
+        {
+            jacobiFunctionRow(state->function, rowCells, nextCells, state->stride, rowMask, state->m,
+                              &state->rowHeat[row]);
+        }
+    }
+}
+
+/**
+ * this function sums the heat of the rows in their order, so the result doesn't depend on the bands
+ * @param state : the state of the calculation
+ * @return the heat of the grid after the sweep
+ */
+double sumRowHeat(const parallel_state *state)
+{
+    size_t row;
+    double sum = 0, compensation = 0;
+    for (row = 0; row < state->n; ++row)
+    {
+        ADD_HEAT(sum, compensation, state->rowHeat[row].sum + state->rowHeat[row].compensation);
+    }
+    return sum + compensation;
+}
+
+/**
+ * this function is the loop every thread of the pool runs. the first band's thread also refreshes the halo
+ * between the colors, swaps the Jacobi grids and decides when the calculation is over.
+ * @param arg : the band of the thread
+ * @return NULL
+ */
+void *runBand(void *arg)
+{
+    parallel_band *band = (parallel_band *) arg;
+    parallel_state *state = band->state;
+    int isLeader = band->firstRow == 0;
+    unsigned int iteration = 0;
+    for (;;)
+    {
+        if (isLeader && state->stats != NULL)
+        {
+            state->sweepStart = statsSeconds();
+        }
+        if (state->scheme == JACOBI)
+        {
+            updateJacobi(state, band->firstRow, band->lastRow);
+        }
+        else
+        {
+            updateColor(state, band->firstRow, band->lastRow, RED);
+            pthread_barrier_wait(&state->barrier);
+            if (isLeader && state->isCyclic)
+            {
+                wrapHalo(state->grid, state->stride, state->n, state->m);
+            }
+            pthread_barrier_wait(&state->barrier);
+            updateColor(state, band->firstRow, band->lastRow, BLACK);
+        }
+        pthread_barrier_wait(&state->barrier);
+        ++iteration;
+        if (isLeader)
+        {
+            double reductionStart = state->stats != NULL ? statsSeconds() : 0;
+            if (state->scheme == JACOBI)
+            { // the next grid becomes the last one
+                double *lastGrid = state->grid;
+                state->grid = state->nextGrid;
+                state->nextGrid = lastGrid;
+            }
+            state->initialHeatAmount = state->currHeatAmount;
+            state->currHeatAmount = sumRowHeat(state);
+            if (state->n_iter > 0)
+            {
+                state->done = iteration >= state->n_iter;
+            }
+            else
+            {
+                state->done = finishSweep(state->check, state->grid, state->stride, state->initialHeatAmount,
+                                          state->currHeatAmount);
+                if (!state->done)
+                {
+                    prepareSweep(state->check, state->grid, state->stride);
+                }
+            }
+            if (state->stats != NULL)
+            {
+                recordSweep(state->stats, state->function, state->grid, state->stride, state->n, state->m,
+                            state->sourceMask, state->isCyclic, 1, state->sweepStart, reductionStart,
+                            state->initialHeatAmount, state->currHeatAmount);
+            }
+            if (!state->done && state->isCyclic)
+            {
+                wrapHalo(state->grid, state->stride, state->n, state->m);
+            }
+        }
+        pthread_barrier_wait(&state->barrier);
+        if (state->done)
+        {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * this function is the entry of a thread of the pool- it waits until all the pool started, then runs its band
+ * @param arg : the band of the thread
+ * @return NULL
+ */
+void *startBand(void *arg)
+{
+    parallel_state *state = ((parallel_band *) arg)->state;
+    pthread_mutex_lock(&state->startLock);
+    while (state->startState == START_WAIT)
+    {
+        pthread_cond_wait(&state->startChanged, &state->startLock);
+    }
+    int startState = state->startState;
+    pthread_mutex_unlock(&state->startLock);
+    if (startState == START_ABORT)
+    {
+        return NULL;
+    }
+    return runBand(arg);
+}
+
+/**
+ * this function releases the threads of the pool that wait in startBand
+ * @param state : the state of the calculation
+ * @param startState : START_GO to run the bands, START_ABORT to quit
+ */
+void releasePool(parallel_state *state, int startState)
+{
+    pthread_mutex_lock(&state->startLock);
+    state->startState = startState;
+    pthread_cond_broadcast(&state->startChanged);
+    pthread_mutex_unlock(&state->startLock);
+}
+
+/**
+ * this function calculates the heat equation with red-black or Jacobi sweeps on a pool of threads.
+ * @param function : the function that calculates the new value of the cell
+ * @param grid : the strided grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sourceMask : the source mask filled by markSources
+ * @param check : the convergence check, for n_iter zero
+ * @param n_iter : the number of iterations given
+ * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic the halo holds the wrapped neighbors
+ * @param scheme : RED_BLACK or JACOBI
+ * @param num_threads : the number of threads to split the sweeps between (at most one for every row)
+ * @param simd : the widest instructions the Jacobi kernel of the built-in heat equation may use
+ * @param stats : the statistics to record every sweep in, or NULL
+ * @return the heat difference in the last round (or the measure of the convergence check, for n_iter zero), or a
+ * negative value if the memory couldn't be allocated
+ */
+double calculateParallel(diff_func function, double *grid, size_t stride, size_t n, size_t m,
+                         const unsigned char *sourceMask, convergence_check *check, unsigned int n_iter,
+                         int is_cyclic, iteration_scheme scheme, unsigned int num_threads, simd_level simd,
+                         calc_stats *stats)
+{
+    parallel_state state = {scheme, function, selectHeatRowKernel(simd), grid, NULL, stride, n, m, sourceMask,
+                            check, n_iter, is_cyclic};
+    state.numThreads = num_threads == 0 ? 1 : num_threads > n ? (unsigned int) n : num_threads;
+    state.rowHeat = (heat_sum *) malloc(n * sizeof(heat_sum));
+    parallel_band *bands = (parallel_band *) malloc(state.numThreads * sizeof(parallel_band));
+    pthread_t *threads = (pthread_t *) malloc(state.numThreads * sizeof(pthread_t));
+    size_t nextStride = stride;
+    if (scheme == JACOBI)
+    { // same dimensions, so the same stride
+        state.nextGrid = allocStridedGrid(n, m, &nextStride);
+    }
+    if (state.rowHeat == NULL || bands == NULL || threads == NULL || (scheme == JACOBI && state.nextGrid == NULL))
+    {
+        free(state.rowHeat);
+        free(bands);
+        free(threads);
+        freeStridedGrid(state.nextGrid, nextStride);
+        return -1;
+    }
+    unsigned int i, started;
+    for (i = 0; i < state.numThreads; ++i)
+    { // split the rows evenly between the bands
+        bands[i].state = &state;
+        bands[i].firstRow = n * i / state.numThreads;
+        bands[i].lastRow = n * (i + 1) / state.numThreads;
+    }
+    state.currHeatAmount = roundStartHeat(check, grid, stride, n, m);
+    state.done = 0;
+    state.stats = stats;
+    if (is_cyclic)
+    {
+        wrapHalo(grid, stride, n, m);
+    }
+    if (n_iter == 0)
+    {
+        prepareSweep(check, grid, stride);
+    }
+
+    pthread_mutex_init(&state.startLock, NULL);
+    pthread_cond_init(&state.startChanged, NULL);
+    state.startState = START_WAIT;
+    for (started = 1; started < state.numThreads; ++started)
+    {
+        if (pthread_create(&threads[started], NULL, startBand, &bands[started]) != 0)
+        {
+            break;
+        }
+    }
+    if (started < state.numThreads)
+    { // not all the threads could start- run the whole grid on this one
+        releasePool(&state, START_ABORT);
+        for (i = 1; i < started; ++i)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        started = 1;
+        state.numThreads = 1;
+        bands[0].lastRow = n;
+    }
+    pthread_barrier_init(&state.barrier, NULL, state.numThreads);
+    releasePool(&state, START_GO);
+    runBand(&bands[0]);
+    for (i = 1; i < started; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&state.barrier);
+    pthread_cond_destroy(&state.startChanged);
+    pthread_mutex_destroy(&state.startLock);
+    if (state.grid != grid)
+    { // the last sweep wrote the second grid
+        size_t row;
+        for (row = 0; row < n; ++row)
+        {
+            memcpy(grid + row * stride, state.grid + row * stride, m * sizeof(double));
+        }
+        state.nextGrid = state.grid;
+    }
+    freeStridedGrid(state.nextGrid, nextStride);
+    free(state.rowHeat);
+    free(bands);
+    free(threads);
+    return n_iter > 0 ? fabs(state.currHeatAmount - state.initialHeatAmount) : check->metric;
+}
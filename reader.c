@@ -20,8 +20,18 @@
 #include <stdio.h>
 #include <malloc.h>
 #include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include "calculator.h"
 #include "heat_eqn.h"
+#include "output.h"
+#include "tokenizer.h"
+#include "binary_input.h"
+#include "warm_start.h"
+#include "checkpoint.h"
+#include "batch.h"
 
 // -------------------------- const definitions -------------------------
 
@@ -32,10 +42,62 @@
 char *ARGS_ERROR = "One argument expected.\n";
 
 /**
- * the number of args expected in this program
+ * the number of args expected in this program (not counting the options)
  */
 int NUM_OF_ARGS = 2;
 
+/**
+ * @var an error massage
+ *@brief for the case that an option given is unknown or has a bad value
+ */
+char *OPTION_ERROR = "Invalid option.\n";
+
+/**
+ * @brief the command line options and the names of their values
+ */
+char *SCHEME_OPTION = "--scheme=";
+char *THREADS_OPTION = "--threads=";
+char *PROCESSES_OPTION = "--processes=";
+char *OMEGA_OPTION = "--omega=";
+char *BLOCK_OPTION = "--block-sweeps=";
+char *SIMD_OPTION = "--simd=";
+char *SNAPSHOTS_OPTION = "--snapshots=";
+char *ASYNC_OUTPUT_OPTION = "--async-output=";
+char *TO_BINARY_OPTION = "--to-binary=";
+char *WARM_START_OPTION = "--warm-start=";
+char *CHECKPOINT_OPTION = "--checkpoint=";
+char *CHECKPOINT_EVERY_OPTION = "--checkpoint-every=";
+char *CHECKPOINT_SWEEPS_OPTION = "--checkpoint-sweeps=";
+char *RESUME_OPTION = "--resume";
+char *STATS_OPTION = "--stats=";
+char *CONVERGENCE_OPTION = "--convergence=";
+char *CHECK_EVERY_OPTION = "--check-every=";
+char *TILE_THRESHOLD_OPTION = "--tile-threshold=";
+char *TILE_SIZE_OPTION = "--tile-size=";
+char *BATCH_OPTION = "--batch=";
+char *WORKERS_OPTION = "--workers=";
+char *GAUSS_SEIDEL_NAME = "gauss-seidel";
+char *RED_BLACK_NAME = "red-black";
+char *JACOBI_NAME = "jacobi";
+char *SOR_NAME = "sor";
+char *MULTIGRID_NAME = "multigrid";
+char *AUTO_NAME = "auto";
+
+/**
+ * @brief the names of the vector instructions, in the order of simd_level
+ */
+char *SIMD_NAMES[] = {"auto", "scalar", "sse2", "avx2", "avx512"};
+
+/**
+ * @brief the names of the convergence policies, in the order of convergence_policy
+ */
+char *CONVERGENCE_NAMES[] = {"heat", "max-norm", "l2", "predictive"};
+
+/**
+ * the bound of the relaxation factor- SOR converges for 0 < omega < MAX_OMEGA
+ */
+double MAX_OMEGA = 2;
+
 /**
  *@var an error massage
  *@brief for the case that the file was writen in a bad format or the input given was not a legal input
@@ -48,25 +110,61 @@ char *INPUT_FILE_ERROR = "Error while reading the file- the input is not valid";
  */
 
 char *OPEN_FILE_ERROR = "Error! opening file";
+
+/**
+ * @var an error massage
+ *@brief for the case that the output fails to be written
+ */
+char *WRITE_ERROR = "Error! writing the output";
+
+/**
+ * @var an error massage
+ *@brief for the case that the warm start file isn't an output of a grid of the same size
+ */
+char *WARM_START_ERROR = "Error! the warm start file is not an output of this grid";
+
+/**
+ * @var an error massage
+ *@brief for the case that the checkpoint file to resume from is a checkpoint of another calculation
+ */
+char *CHECKPOINT_ERROR = "Error! the checkpoint file is not a checkpoint of this calculation";
+
+/**
+ * @var an error massage
+ *@brief for the case that a checkpoint fails to be written (the calculation goes on)
+ */
+char *CHECKPOINT_WRITE_ERROR = "Error! writing the checkpoint";
+
+/**
+ * @var an error massage
+ *@brief for the case that the list of the cases of a batch fails to be read, or the batch fails to start
+ */
+char *BATCH_ERROR = "Error! running the batch";
 /**
  * @brief the sign of the separation between the parts of the data in the given file
  */
 char *SEPARATOR = "----";
 
 /**
- * @brief a new line sign
+ * @brief the size of the buffer the separator line is read to, and the number of its dashes that are checked
  */
-char NEW_LINE = '\n';
+#define SEPARATOR_BUFFER 20
+#define SEPARATOR_PREFIX 3
 
 /**
- * @brief this is an error massage for the case that the malloc/realloc fails to allocate memory
+ * the number of source points the list of the source points starts with (it doubles when it fills)
  */
-char *MEMORY_ERROR = "Fail to allocate memory";
+#define INITIAL_SOURCES_CAPACITY 64
+
+/**
+ * the number of sweeps of a round until terminate between two checkpoints, unless another one is given
+ */
+#define DEFAULT_CHECKPOINT_SWEEPS 1000
 
 /**
- * the initial value for a cell in the grid
+ * @brief this is an error massage for the case that the malloc/realloc fails to allocate memory
  */
-int INIT_VAL = 0;
+char *MEMORY_ERROR = "Fail to allocate memory";
 
 /**
  * @brief true and false signs- for readability of the program
@@ -74,35 +172,69 @@ int INIT_VAL = 0;
 #define TRUE 0
 #define FALSE 1
 
-
-// ------------------------------ functions -----------------------------
+/**
+ * @brief the options of the program- the options of the calculation and of its output
+ */
+typedef struct
+{
+    calc_options calc;
+    /** the file the binary snapshots of the rounds are appended to, or NULL for printing them as text */
+    char *snapshot_file;
+    /** the output of a former run the grid starts from (before the source points are set), or NULL */
+    char *warm_start_file;
+    /** the file the input is converted to (a binary input file) instead of calculating it, or NULL */
+    char *binary_file;
+    /** the number of rounds that may wait for a writer thread, or 0 for writing every round before the next */
+    unsigned int output_queue;
+    /** the file the checkpoints are written to, or NULL for no checkpoints */
+    char *checkpoint_file;
+    /** the number of rounds between two checkpoints, and of sweeps of a round until terminate */
+    unsigned int checkpoint_every, checkpoint_sweeps;
+    /** 1 for resuming from the checkpoint file (if it exists) and 0 for starting over */
+    int resume;
+    /** the file the statistics of the calculation are written to (as JSON lines), or NULL for none */
+    char *stats_file;
+    /** the directory the outputs of a batch are written to, or NULL for solving a single input file */
+    char *batch_dir;
+    /** the number of worker threads of a batch, or 0 for the number of cpus */
+    unsigned int batch_workers;
+    /** the file the text output is written to instead of the standard output (a case of a batch), or NULL */
+    const char *output_file;
+    /** the solver the calculation runs in (the solver of the worker of a batch), or NULL for a solver of its own */
+    solver_context *solver;
+} program_options;
 
 /**
- * this function moves the file pointer to a new line.
- * @param file the file we want to read
+ * @brief the checkpoints of a calculation- what a checkpoint needs besides the grid, inside a round too
  */
-void newLine(FILE *file)
+typedef struct
 {
-    int curr;
-    do
-    {
-        curr = fgetc(file);
-    } while (curr != NEW_LINE);
-}
+    /** the writer of the output, and the writer thread that writes the rounds (or NULL) */
+    grid_writer *writer;
+    async_writer *async;
+    /** the state of the rounds, and the name of the checkpoint file */
+    checkpoint_state *state;
+    const char *fileName;
+    /** TRUE while the checkpoints are written, and FALSE after one failed (or with no checkpoint file) */
+    int isCheckpointed;
+} calc_checkpoints;
 
 
+// ------------------------------ functions -----------------------------
+
 /**
- * this function reads the next line in the given file and finds out if its a separator or not
- * @param file the file we read
+ * this function reads the next line in the given input and finds out if its a separator or not. like fgets with a
+ * buffer of SEPARATOR_BUFFER bytes, a long line is read up to its first SEPARATOR_BUFFER - 1 bytes.
+ * @param input the input we read
  * @return TRUE if the line was a separator line, FALSE otherwise
  */
-int readSeparator(FILE *file)
+int readSeparator(input_cursor *input)
 {
-    char currString[20];
+    const char *line;
     // find the separator
-    fgets(currString, 20, file);
-    // check to separator if its as expected
-    if (strncmp(currString, SEPARATOR, 3) != 0)
+    size_t length = readLinePrefix(input, &line, SEPARATOR_BUFFER - 1);
+    // check to separator if its as expected (the source points reading took its first dash)
+    if (length < SEPARATOR_PREFIX || strncmp(line, SEPARATOR, SEPARATOR_PREFIX) != 0)
     {
         return FALSE;
     }
@@ -116,7 +248,7 @@ int readSeparator(FILE *file)
  * @param value the value of the point
  * @param point the point we want to initialize
  */
-void initSourcePoint(int xCoordinate, int yCoordinate, float value, source_point *point)
+void initSourcePoint(int xCoordinate, int yCoordinate, double value, source_point *point)
 {
     point->x = xCoordinate;
     point->y = yCoordinate;
@@ -124,48 +256,56 @@ void initSourcePoint(int xCoordinate, int yCoordinate, float value, source_point
 }
 
 /**
- * this function reads from the file the number of rows and columns of the grid
+ * this function reads from the input the number of rows and columns of the grid
  * @param n the number of rows pointer
  * @param m the number of columns pointer
- * @param file the file we read
+ * @param input the input we read
  * @return TRUE for a successful reading of the data and false otherwise
  */
-int getSizeOfCalcArea(size_t *n, size_t *m, FILE *file)
+int getSizeOfCalcArea(size_t *n, size_t *m, input_cursor *input)
 {
     int rows, cols;
-    if (fscanf(file, "%d , %d", &rows, &cols) != 2 || rows <= 0 || cols <= 0)
+    if (!(scanInt(input, &rows) && scanLiteral(input, ',') && scanInt(input, &cols)) || rows <= 0 || cols <= 0)
     { // if the input is not valid
         return FALSE;
     }
     *n = (size_t) rows;
     *m = (size_t) cols;
-    newLine(file);
+    skipLine(input);
     return TRUE;
 }
 
 /**
- * this function reads the source points from the file
- * @param file the file we want to read
+ * this function reads the source points from the input- "x, y, value" until the separator. the list grows
+ * geometrically, so millions of points are read in linear time.
+ * @param input the input we want to read
  * @param numOfSourcePoints the number of source points that the reader finds
- * @return TRUE for a successful reading of the data and false otherwise
+ * @return the source points, or NULL if the memory couldn't be allocated
  */
-//TODO CHECK THE INPUT OF THE POINTS- MAYBE OUT OF THE BOARD
-source_point *getSourcePoints(FILE *file, size_t *numOfSourcePoints)
+source_point *getSourcePoints(input_cursor *input, size_t *numOfSourcePoints)
 {
-    size_t currNumOfPoints = 0;
+    size_t currNumOfPoints = 0, capacity = INITIAL_SOURCES_CAPACITY;
     int xCoordinate, yCoordinate;
-    float value;
-    source_point *sourcePoints = (source_point *) malloc(sizeof(source_point) * (currNumOfPoints));
+    double value;
+    source_point *sourcePoints = (source_point *) malloc(sizeof(source_point) * capacity);
     if (sourcePoints == NULL)
     { // fail to allocate memory
         return NULL;
     }
-    while (fscanf(file, " %d , %d , %f ", &xCoordinate, &yCoordinate, &value) == 3)
+    while (scanInt(input, &xCoordinate) && scanLiteral(input, ',') && scanInt(input, &yCoordinate) &&
+           scanLiteral(input, ',') && scanDouble(input, &value))
     {
-        sourcePoints = realloc(sourcePoints, sizeof(source_point) * (currNumOfPoints + 1));
-        if (sourcePoints == NULL)
-        { // fail to allocate memory
-            return NULL;
+        skipSpaces(input);
+        if (currNumOfPoints == capacity)
+        {
+            source_point *larger = (source_point *) realloc(sourcePoints, sizeof(source_point) * capacity * 2);
+            if (larger == NULL)
+            { // fail to allocate memory
+                free(sourcePoints);
+                return NULL;
+            }
+            sourcePoints = larger;
+            capacity *= 2;
         }
         initSourcePoint(xCoordinate, yCoordinate, value, &sourcePoints[currNumOfPoints++]);
     }
@@ -174,33 +314,34 @@ source_point *getSourcePoints(FILE *file, size_t *numOfSourcePoints)
 }
 
 /**
- * this function reads from the file the ending value given
- * @param file the file we want to read
+ * this function reads from the input the ending value given
+ * @param input the input we want to read
  * @param endingVal the ending val pointer to init
  * @return TRUE for a successful reading of the data and false otherwise
  */
-int getEndingVal(FILE *file, double *endingVal)
+int getEndingVal(input_cursor *input, double *endingVal)
 {
     // Actual number ending value in scientific writing
-    char endingValStr[20];
-    if (fscanf(file, "%s", endingValStr) != 1)
+    const char *endingValStr;
+    size_t length = scanWord(input, &endingValStr);
+    if (length == 0)
     {
         return FALSE;
     }
-    *endingVal = strtod(endingValStr, NULL); // turn to a double
+    *endingVal = wordToDouble(endingValStr, length); // turn to a double
     return TRUE;
 }
 
 /**
- * this function reads the number of iterations between prints - zero for end printing only, from the file.
- * @param file : the file we want to read
+ * this function reads the number of iterations between prints - zero for end printing only, from the input.
+ * @param input : the input we want to read
  * @param iterationsNum : the number of iterations pointer to init
  * @return TRUE for a successful reading of the data and false otherwise
  */
-int getIterationsNum(FILE *file, unsigned int *iterationsNum)
+int getIterationsNum(input_cursor *input, unsigned int *iterationsNum)
 {
     int curr;
-    if (fscanf(file, "%d", &curr) != 1 || curr < 0)
+    if (!scanInt(input, &curr) || curr < 0)
     { // if number of iteration is a negative number than its not valid
         return FALSE;
     }
@@ -209,14 +350,14 @@ int getIterationsNum(FILE *file, unsigned int *iterationsNum)
 }
 
 /**
- * this function reads from the file the flag is cyclic. 0 for not cyclic and 1 for cyclic
- * @param file the file we want to read from
+ * this function reads from the input the flag is cyclic. 0 for not cyclic and 1 for cyclic
+ * @param input the input we want to read from
  * @param isCyclic the pointer to the flag we want to init
  * @return TRUE for a successful reading of the data and false otherwise
  */
-int getIsCyclic(FILE *file, int *isCyclic)
+int getIsCyclic(input_cursor *input, int *isCyclic)
 {
-    if (fscanf(file, "%d", isCyclic) != 1 || (*isCyclic != 0 && *isCyclic != 1))
+    if (!scanInt(input, isCyclic) || (*isCyclic != 0 && *isCyclic != 1))
     { // not a valid input
         return FALSE;
     }
@@ -224,92 +365,312 @@ int getIsCyclic(FILE *file, int *isCyclic)
 }
 
 /**
- * this function builds the grid- allocates memory for it and returns TRUE if it succeeded
- * @param grid : the pointer for the grid we want to build
- * @param rows : the number of rows of the grid
- * @param columns : the number of columns of the grid
- * @return TRUE for a successful allocating and false otherwise
+ * this function builds the grid in the solver- configures the solver for the calculation, inits the grid values
+ * to zero (or to the given initial grid) and adds the the grid the source points values
+ * @param solver : the solver
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sources : the list of all the source points
+ * @param numOfSources : the number of source points
+ * @param terminate : the termination value
+ * @param n_iter : the number of iterations given
+ * @param isCyclic : 1 if its cyclic and 0 if its not
+ * @param initialCells : the initial grid (n * m in row major order), or NULL
+ * @param calc : the options of the calculation
+ * @return TRUE for a successful allocating and FALSE otherwise
  */
-int buildGrid(double ***grid, size_t rows, size_t columns)
+int buildGrid(solver_context *solver, size_t n, size_t m, source_point *sources, size_t numOfSources,
+              double terminate, unsigned int n_iter, int isCyclic, const double *initialCells,
+              const calc_options *calc)
 {
-    *grid = (double **) malloc(rows * sizeof(double *));
-    if (*grid == NULL)
+    if (configureSolver(solver, heat_eqn, n, m, terminate, n_iter, isCyclic, calc) != 0)
     {
         return FALSE;
     }
-    for (int i = 0; i < rows; ++i)
+    setSolverCells(solver, initialCells);
+    setSolverSources(solver, sources, numOfSources);
+    return TRUE;
+}
+
+/**
+ * this function prints the result given from "calculate" and the grid cells (or writes their binary snapshot)
+ * @param writer : the writer of the output
+ * @param async : the writer thread that writes the rounds, or NULL for writing them here
+ * @param grid : the grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param result : the result of calculate function
+ * @return TRUE for a successful writing and FALSE otherwise
+ */
+int printResults(grid_writer *writer, async_writer *async, const double *grid, size_t stride, size_t n, size_t m,
+                 double result)
+{
+    int status = async != NULL ? submitRound(async, grid, stride, result)
+                               : writeRound(writer, grid, stride, n, m, result);
+    if (status != 0)
     {
-        (*grid)[i] = (double *) malloc(columns * sizeof(double));
-        if ((*grid)[i] == NULL)
-        {
-            return FALSE;
-        }
+        fprintf(stderr, "%s", WRITE_ERROR);
+        return FALSE;
     }
     return TRUE;
 }
 
 /**
- * this function inits the grid values to zero and adds the the grid the source points values
- * @param grid : the grid of all the cells holding their values
- * @param numOfRows : the number of rows in the grid
- * @param numOfCol : the number of columns in the grid
- * @param sources : the list of all the source points
- * @param numOfSources : the number of source points
+ * this function opens the output of the calculation- the snapshot file (for appending) if one was given, the
+ * output file (from its start) if one was given and the standard output otherwise
+ * @param writer : the writer to open
+ * @param options : the options of the program
+ * @return TRUE for a successful opening and FALSE otherwise (after printing the error)
  */
-void initGrid(double **grid, size_t numOfRows, size_t numOfCol, source_point *sources, int numOfSources)
+int openOutput(grid_writer *writer, const program_options *options)
 {
-    int row, col;
-    for (row = 0; row < numOfRows; ++row)
+    int fd = STDOUT_FILENO;
+    if (options->snapshot_file != NULL)
+    {
+        fd = open(options->snapshot_file, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    }
+    else if (options->output_file != NULL)
+    {
+        fd = open(options->output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s", OPEN_FILE_ERROR);
+        return FALSE;
+    }
+    if (openGridWriter(writer, options->snapshot_file != NULL ? RAW_OUTPUT : CSV_OUTPUT, fd) != 0)
     {
-        for (col = 0; col < numOfCol; ++col)
+        fprintf(stderr, "%s", MEMORY_ERROR);
+        if (fd != STDOUT_FILENO)
         {
-            grid[row][col] = INIT_VAL;
+            close(fd);
         }
+        return FALSE;
     }
-    int i;
-    for (i = 0; i < numOfSources; ++i)
-    { // init source points in the grid
-        grid[sources[i].x][sources[i].y] = sources[i].value;
+    return TRUE;
+}
+
+/**
+ * this function closes the output of the calculation
+ * @param writer : the writer to close
+ */
+void closeOutput(grid_writer *writer)
+{
+    if (writer->fd != STDOUT_FILENO)
+    {
+        close(writer->fd);
     }
+    closeGridWriter(writer);
 }
 
 /**
- * this function free the memory allocated to the grid
- * @param grid : the grid of all the cells holding their values
- * @param numOfRows : the number of rows in the grid
+ * this function brings the output back to where it was at a checkpoint- the rounds written after it by the
+ * stopped run are cut, since the resumed run writes them again. an output that isn't a file, or that is shorter
+ * than it was (a new file), is left as it is.
+ * @param writer : the writer of the output
+ * @param checkpoint : the state of the rounds at the checkpoint
+ * @return TRUE on success and FALSE if the output couldn't be cut (after printing the error)
  */
-void freeGrid(double ***grid, size_t numOfRows)
+int restoreOutput(grid_writer *writer, const checkpoint_state *checkpoint)
 {
-    for (int i = 0; i < numOfRows; i++)
-        free((*grid)[i]);
-    free(*grid);
+    struct stat status;
+    if (checkpoint->output_offset < 0 || fstat(writer->fd, &status) != 0 || !S_ISREG(status.st_mode) ||
+        status.st_size < checkpoint->output_offset)
+    {
+        return TRUE;
+    }
+    if (ftruncate(writer->fd, (off_t) checkpoint->output_offset) != 0 ||
+        lseek(writer->fd, (off_t) checkpoint->output_offset, SEEK_SET) < 0)
+    {
+        fprintf(stderr, "%s", WRITE_ERROR);
+        return FALSE;
+    }
+    return TRUE;
 }
 
 /**
- * this function prints the grid cells one by one and the result given from "calculate"
+ * this function writes a checkpoint of the rounds written so far (and of where the round in progress is, in its
+ * state). the rounds waiting for the writer thread are written first, so the size of the output is the size
+ * after the last round. a checkpoint that fails to be written is reported, and the calculation goes on without
+ * checkpoints.
+ * @param checkpoints : the checkpoints of the calculation, the output offset of their state is updated
  * @param grid : the grid of all the cells holding their values
+ * @param stride : the distance between two rows of the grid
  * @param n : the number of rows in the grid
  * @param m : the number of columns in the grid
- * @param result : the result of calculate function
  */
-void printResults(double **grid, size_t n, size_t m, double result)
+void saveCheckpoint(calc_checkpoints *checkpoints, const double *grid, size_t stride, size_t n, size_t m)
 {
-    int i, j;
-    printf("%lf\n", result);
-    for (i = 0; i < n; ++i)
+    if (checkpoints->async != NULL && drainAsyncWriter(checkpoints->async) != 0)
+    { // the output is broken, the next round reports it
+        return;
+    }
+    checkpoints->state->output_offset = (int64_t) lseek(checkpoints->writer->fd, 0, SEEK_CUR);
+    if (writeCheckpoint(checkpoints->fileName, grid, stride, n, m, checkpoints->state) != 0)
     {
-        for (j = 0; j < m; ++j)
-        {
-            printf("%2.4lf,", grid[i][j]);
-        }
-        printf("\n");
+        fprintf(stderr, "%s", CHECKPOINT_WRITE_ERROR);
+        checkpoints->isCheckpointed = FALSE;
     }
 }
 
 /**
- * this function activates the calculation and prints it
- * @param function : the function that calculates the new value of the cell
- * @param grid : the grid of all the cells holding their values
+ * this function writes a checkpoint inside a round until terminate- it is the progress function of the
+ * calculation (see progress_func)
+ * @param context : the checkpoints of the calculation
+ * @param grid : the grid of all the cells holding their values, after the sweep
+ * @param stride : the distance between two rows of the grid
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param progress : where the round is
+ */
+void saveRoundProgress(void *context, const double *grid, size_t stride, size_t n, size_t m,
+                       const round_progress *progress)
+{
+    calc_checkpoints *checkpoints = (calc_checkpoints *) context;
+    if (checkpoints->isCheckpointed == FALSE)
+    {
+        return;
+    }
+    checkpoints->state->progress = *progress;
+    saveCheckpoint(checkpoints, grid, stride, n, m);
+}
+
+/**
+ * this function writes a field of a JSON object- a number, or null for NaN and infinity that JSON doesn't have
+ * @param file : the file to write
+ * @param name : the name of the field
+ * @param value : the number
+ * @param separator : the text after the field
+ */
+void printJsonNumber(FILE *file, const char *name, double value, const char *separator)
+{
+    if (isfinite(value))
+    {
+        fprintf(file, "\"%s\":%.17g%s", name, value, separator);
+    }
+    else
+    {
+        fprintf(file, "\"%s\":null%s", name, separator);
+    }
+}
+
+/**
+ * this function writes the statistics of the calculation as JSON lines- a line for every record of a sweep and
+ * a summary line
+ * @param fileName : the name of the file
+ * @param stats : the statistics
+ * @param solveSeconds : the time the calculation took
+ * @return TRUE for a successful writing and FALSE otherwise (after printing the error)
+ */
+int writeStats(const char *fileName, const calc_stats *stats, double solveSeconds)
+{
+    FILE *file = fopen(fileName, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "%s", OPEN_FILE_ERROR);
+        return FALSE;
+    }
+    size_t i;
+    unsigned long sweeps = 0;
+    for (i = 0; i < stats->num_sweeps; ++i)
+    {
+        const sweep_record *record = &stats->sweeps[i];
+        sweeps += record->sweeps;
+        fprintf(file, "{\"type\":\"sweep\",\"round\":%lu,\"sweep\":%lu,\"sweeps\":%u,", record->round, sweeps,
+                record->sweeps);
+        printJsonNumber(file, "seconds", record->seconds, ",");
+        printJsonNumber(file, "cells_per_second", (double) stats->cells * record->sweeps / record->seconds, ",");
+        printJsonNumber(file, "heat", record->heat, ",");
+        printJsonNumber(file, "heat_diff", record->heat_diff, ",");
+        printJsonNumber(file, "residual", record->residual, "}\n");
+    }
+    fprintf(file, "{\"type\":\"summary\",\"rounds\":%lu,\"sweeps\":%lu,\"cells\":%lu,\"truncated\":%s,"
+                  "\"updated_tiles\":%lu,\"skipped_tiles\":%lu,", stats->rounds, stats->total_sweeps,
+            (unsigned long) stats->cells, stats->is_truncated ? "true" : "false", stats->updated_tiles,
+            stats->skipped_tiles);
+    printJsonNumber(file, "solve_seconds", solveSeconds, ",");
+    printJsonNumber(file, "update_seconds", stats->update_seconds, ",");
+    printJsonNumber(file, "reduction_seconds", stats->reduction_seconds, ",");
+    printJsonNumber(file, "output_seconds", stats->output_seconds, ",");
+    printJsonNumber(file, "cells_per_second", (double) stats->cells * stats->total_sweeps / stats->update_seconds,
+                    "}\n");
+    if (fclose(file) != 0)
+    {
+        fprintf(stderr, "%s", WRITE_ERROR);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * this function runs the calculation again from its start with a check after every sweep, with the measure of
+ * the policy (the largest change of a cell for the predictive one), to count the sweeps it takes
+ * @param solver : the solver to run it in (it is configured again)
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param sources : the list of the source points
+ * @param num_sources : the number of source points
+ * @param terminate : the termination value
+ * @param is_cyclic : 1 if its cyclic and 0 if its not
+ * @param initialCells : the initial grid (n * m in row major order), or NULL for a grid of zeros
+ * @param options : the options of the calculation
+ * @param sweeps : a pointer for the number of sweeps
+ * @return TRUE if the calculation ran and FALSE if the memory couldn't be allocated
+ */
+int countCheckedSweeps(solver_context *solver, size_t n, size_t m, source_point *sources, size_t num_sources,
+                       double terminate, int is_cyclic, const double *initialCells, const calc_options *options,
+                       unsigned long *sweeps)
+{
+    convergence_report report = {0, 0};
+    calc_options checked = *options;
+    checked.convergence = options->convergence == CHECK_PREDICTIVE ? CHECK_MAX_NORM : options->convergence;
+    checked.check_every = 1;
+    checked.stats = NULL;
+    checked.report = &report;
+    checked.on_progress = NULL;
+    checked.resume = NULL;
+    if (buildGrid(solver, n, m, sources, num_sources, terminate, 0, is_cyclic, initialCells, &checked) == FALSE ||
+        runSolver(solver) < 0)
+    {
+        return FALSE;
+    }
+    *sweeps = report.sweeps;
+    return TRUE;
+}
+
+/**
+ * this function prints the counts of the convergence checks to stderr- the sweeps until terminate, the checks
+ * among them and the checks the policy saved, and the sweeps it saved (negative if it ran more) against a check
+ * after every sweep if they were counted
+ * @param options : the options of the calculation
+ * @param report : the counts of the checks
+ * @param checkedSweeps : the sweeps with a check after every sweep, or 0 if they weren't counted
+ */
+void printConvergenceReport(const calc_options *options, const convergence_report *report,
+                            unsigned long checkedSweeps)
+{
+    fprintf(stderr, "convergence: %s, check every: %u, sweeps: %lu, checks: %lu, checks saved: %lu",
+            CONVERGENCE_NAMES[options->convergence], options->check_every, report->sweeps, report->checks,
+            report->sweeps - report->checks);
+    if (checkedSweeps > 0)
+    {
+        fprintf(stderr, ", sweeps saved: %ld (of %lu with a check after every sweep)",
+                (long) checkedSweeps - (long) report->sweeps, checkedSweeps);
+    }
+    fprintf(stderr, "\n");
+}
+
+/**
+ * this function activates the calculation and prints it. with a checkpoint file, a checkpoint is written every
+ * checkpoint_every rounds and every checkpoint_sweeps sweeps of a round until terminate (a checkpoint that fails
+ * to be written is reported, and the calculation goes on without checkpoints); a resumed calculation goes on
+ * from its checkpoint- from the middle of its round, if it was written there- unless it was of the last round.
+ * with a statistics file, the statistics of the calculation (and the time of the output) are written to it.
+ * a convergence policy other than the default reports the checks it saved; with a statistics file the
+ * calculation until terminate then runs again from its start with a check after every sweep, to report the
+ * sweeps the policy saved too (not for a resumed calculation).
+ * @param solver : the solver the calculation runs in
  * @param n : the number of rows in the grid
  * @param m : the number of columns in the grid
  * @param sources : the list of the source points
@@ -317,19 +678,123 @@ void printResults(double **grid, size_t n, size_t m, double result)
  * @param terminate : the termination value
  * @param n_iter : the number of iterations given
  * @param isCyclic : 1 if its cyclic and 0 if its not. for cyclic we will use mod to get the neighbors
- * @return the heat difference in the last round
+ * @param initialCells : the initial grid (n * m in row major order), or NULL for a grid of zeros
+ * @param options : the options of the program
+ * @param checkpoint : the state of the rounds- of the checkpoint resumed from, or of no rounds and no sweeps
+ * @return TRUE if the grid was built and FALSE otherwise (after printing the error)
  */
-void activateCalc(diff_func function, double **grid, size_t n, size_t m, source_point *sources,
-                  size_t num_sources, double terminate, unsigned int n_iter, int is_cyclic)
+int activateCalc(solver_context *solver, size_t n, size_t m, source_point *sources, size_t num_sources,
+                 double terminate, unsigned int n_iter, int is_cyclic, const double *initialCells,
+                 const program_options *options, checkpoint_state *checkpoint)
 {
-    double result;
-    do
+    double result, solveSeconds = 0;
+    grid_writer writer;
+    async_writer async, *queue = NULL;
+    calc_stats stats;
+    convergence_report report = {0, 0};
+    calc_options calc = options->calc;
+    round_progress resumed = checkpoint->progress;
+    int isResumed = checkpoint->rounds > 0 || resumed.sweeps > 0 ? TRUE : FALSE;
+    calc_checkpoints checkpoints = {&writer, NULL, checkpoint, options->checkpoint_file,
+                                    options->checkpoint_file != NULL ? TRUE : FALSE};
+    if (calc.convergence != CHECK_HEAT || calc.check_every > 1)
+    {
+        calc.report = &report;
+    }
+    if (checkpoints.isCheckpointed == TRUE)
     {
-        result = calculate(function, grid, n, m, sources, num_sources, terminate, n_iter, is_cyclic);
-        printResults(grid, n, m, result);
-    } while (result >= terminate);
-    freeGrid(&grid, n);
-    free(sources);
+        calc.on_progress = saveRoundProgress;
+        calc.progress_context = &checkpoints;
+        calc.progress_every = options->checkpoint_sweeps;
+    }
+    if (resumed.sweeps > 0)
+    { // the checkpoint was written in the middle of a round
+        calc.resume = &resumed;
+    }
+    if (options->stats_file != NULL)
+    {
+        memset(&stats, 0, sizeof(calc_stats));
+        calc.stats = &stats;
+    }
+    if (buildGrid(solver, n, m, sources, num_sources, terminate, n_iter, is_cyclic, initialCells, &calc) == FALSE)
+    {
+        fprintf(stderr, "%s", MEMORY_ERROR);
+        return FALSE;
+    }
+    size_t stride;
+    double *grid = getSolverGrid(solver, &stride);
+    if (openOutput(&writer, options) == FALSE)
+    {
+        return TRUE;
+    }
+    if (isResumed == TRUE && restoreOutput(&writer, checkpoint) == FALSE)
+    {
+        closeOutput(&writer);
+        return TRUE;
+    }
+    if (options->output_queue > 0 && openAsyncWriter(&async, &writer, n, m, options->output_queue) == 0)
+    { // otherwise every round is written before the next one
+        queue = &async;
+        checkpoints.async = queue;
+    }
+    int isWritten = TRUE;
+    if (checkpoint->rounds == 0 || resumed.sweeps > 0 || checkpoint->result >= terminate)
+    { // otherwise the checkpoint is of the last round
+        do
+        {
+            double start = currentSeconds();
+            result = runSolver(solver);
+            solveSeconds += currentSeconds() - start;
+            if (result < 0)
+            { // the calculator failed to allocate its memory
+                fprintf(stderr, "%s", MEMORY_ERROR);
+                break;
+            }
+            start = currentSeconds();
+            isWritten = printResults(&writer, queue, grid, stride, n, m, result);
+            if (calc.stats != NULL)
+            { // with a writer thread, only the time the round waited for a free buffer (and the drain, below)
+                stats.output_seconds += currentSeconds() - start;
+            }
+            checkpoint->result = result;
+            memset(&checkpoint->progress, 0, sizeof(round_progress)); // between two rounds
+            if (isWritten == TRUE && checkpoints.isCheckpointed == TRUE &&
+                ++checkpoint->rounds % options->checkpoint_every == 0)
+            {
+                saveCheckpoint(&checkpoints, grid, stride, n, m);
+            }
+        } while (isWritten == TRUE && result >= terminate);
+    }
+    if (queue != NULL)
+    {
+        if (closeAsyncWriter(queue) != 0 && isWritten == TRUE)
+        { // one of the last rounds failed
+            fprintf(stderr, "%s", WRITE_ERROR);
+        }
+        if (calc.stats != NULL)
+        {
+            stats.output_seconds += queue->drainSeconds;
+        }
+        reportAsyncWriter(queue, solveSeconds);
+    }
+    closeOutput(&writer);
+    if (calc.report != NULL)
+    {
+        unsigned long checkedSweeps = 0;
+        if (calc.stats != NULL && n_iter == 0 && isResumed == FALSE &&
+            countCheckedSweeps(solver, n, m, sources, num_sources, terminate, is_cyclic, initialCells, &calc,
+                               &checkedSweeps) == FALSE)
+        {
+            fprintf(stderr, "%s", MEMORY_ERROR);
+        }
+        printConvergenceReport(&calc, &report, checkedSweeps);
+    }
+    if (calc.stats != NULL)
+    {
+        writeStats(options->stats_file, &stats, solveSeconds);
+        freeCalcStats(&stats);
+    }
+    return TRUE;
 }
 
 /**
@@ -356,7 +821,7 @@ int areSourcesInBoard(size_t n, size_t m, source_point *sources, size_t sourcePo
 /**
  *this function reads line by line the given file and init the values of what it read
  *for all the pointers that are its parameters
- * @param file the file to read
+ * @param input the input of the file to read
  * @param n a pointer for the number of rows
  * @param m a pointer for the number of columns
  * @param sourcePoints a pointer for the list of source points
@@ -366,14 +831,14 @@ int areSourcesInBoard(size_t n, size_t m, source_point *sources, size_t sourcePo
  * @param isCyclic a pointer for the is cyclic flag
  * @return FALSE for a problem while reading the file input. TRUE otherwise
  */
-int readLines(FILE *file, size_t *n, size_t *m, source_point **sourcePoints, size_t *numOfSourcePoints,
+int readLines(input_cursor *input, size_t *n, size_t *m, source_point **sourcePoints, size_t *numOfSourcePoints,
               double *endingVal, unsigned int *iterationsNum, int *isCyclic)
 {
-    if (getSizeOfCalcArea(n, m, file) == FALSE || readSeparator(file) == FALSE)
+    if (getSizeOfCalcArea(n, m, input) == FALSE || readSeparator(input) == FALSE)
     {
         return FALSE;
     }
-    *sourcePoints = getSourcePoints(file, numOfSourcePoints);
+    *sourcePoints = getSourcePoints(input, numOfSourcePoints);
     if (*sourcePoints == NULL)
     {
         fprintf(stderr, "%s", MEMORY_ERROR);
@@ -383,8 +848,8 @@ int readLines(FILE *file, size_t *n, size_t *m, source_point **sourcePoints, siz
     {
         return FALSE;
     }
-    if (readSeparator(file) == FALSE || getEndingVal(file, endingVal) == FALSE ||
-        getIterationsNum(file, iterationsNum) || getIsCyclic(file, isCyclic) == FALSE)
+    if (readSeparator(input) == FALSE || getEndingVal(input, endingVal) == FALSE ||
+        getIterationsNum(input, iterationsNum) || getIsCyclic(input, isCyclic) == FALSE)
     {
         return FALSE;
     }
@@ -392,12 +857,162 @@ int readLines(FILE *file, size_t *n, size_t *m, source_point **sourcePoints, siz
 }
 
 /**
- * this function reads the file given, analyzes the results and prints them
- * @param file the file we want to read
+ * this function writes the input as a binary input file instead of calculating it
+ * @param n the number of rows in the grid
+ * @param m the number of columns in the grid
+ * @param sources the list of the source points
+ * @param numOfSources the number of source points
+ * @param endingVal the termination value
+ * @param iterationsNum the number of iterations given
+ * @param isCyclic 1 if its cyclic and 0 if its not
+ * @param initialCells the initial grid (n * m in row major order), or NULL
+ * @param fileName the name of the binary file
+ */
+void convertInput(size_t n, size_t m, const source_point *sources, size_t numOfSources, double endingVal,
+                  unsigned int iterationsNum, int isCyclic, const double *initialCells, const char *fileName)
+{
+    FILE *file = fopen(fileName, "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "%s", OPEN_FILE_ERROR);
+        return;
+    }
+    if (writeBinaryInput(file, n, m, sources, numOfSources, endingVal, iterationsNum, isCyclic, initialCells,
+                         m) != 0)
+    {
+        fprintf(stderr, "%s", WRITE_ERROR);
+    }
+    fclose(file);
+}
+
+/**
+ * this function builds the grid of the input that was read and calculates it (or converts the input). the grid
+ * starts from the checkpoint resumed from, or else from the warm start file if one was given.
+ * @param n the number of rows in the grid
+ * @param m the number of columns in the grid
+ * @param sources the list of the source points
+ * @param numOfSources the number of source points
+ * @param endingVal the termination value
+ * @param iterationsNum the number of iterations given
+ * @param isCyclic 1 if its cyclic and 0 if its not
+ * @param initialCells the initial grid (n * m in row major order), or NULL for a grid of zeros
+ * @param options the options of the program
+ * @return TRUE for a successful run, FALSE otherwise
+ */
+int runInput(size_t n, size_t m, source_point *sources, size_t numOfSources, double endingVal,
+             unsigned int iterationsNum, int isCyclic, const double *initialCells, const program_options *options)
+{
+    double *warmCells = NULL;
+    if (options->warm_start_file != NULL)
+    {
+        int status = loadWarmStart(options->warm_start_file, n, m, &warmCells);
+        if (status == -3)
+        {
+            fprintf(stderr, "%s", MEMORY_ERROR);
+            return FALSE;
+        }
+        if (status != 0)
+        {
+            fprintf(stderr, "%s", status == -1 ? OPEN_FILE_ERROR : WARM_START_ERROR);
+            return TRUE;
+        }
+        initialCells = warmCells;
+    }
+    if (options->binary_file != NULL)
+    {
+        convertInput(n, m, sources, numOfSources, endingVal, iterationsNum, isCyclic, initialCells,
+                     options->binary_file);
+        free(warmCells);
+        return TRUE;
+    }
+    checkpoint_state checkpoint;
+    memset(&checkpoint, 0, sizeof(checkpoint_state));
+    checkpoint.output_offset = -1;
+    double *resumedCells = NULL;
+    if (options->checkpoint_file != NULL)
+    {
+        const char *output = options->snapshot_file != NULL ? options->snapshot_file : options->output_file;
+        checkpoint.fingerprint = inputFingerprint(n, m, sources, numOfSources, endingVal, iterationsNum, isCyclic,
+                                                  &options->calc, output, options->snapshot_file != NULL);
+    }
+    if (options->checkpoint_file != NULL && options->resume)
+    { // a checkpoint file that doesn't exist yet starts the calculation over
+        int status = loadCheckpoint(options->checkpoint_file, n, m, checkpoint.fingerprint, &checkpoint,
+                                    &resumedCells);
+        if (status == -3)
+        {
+            fprintf(stderr, "%s", MEMORY_ERROR);
+            free(warmCells);
+            return FALSE;
+        }
+        if (status == -2)
+        {
+            fprintf(stderr, "%s", CHECKPOINT_ERROR);
+            free(warmCells);
+            return TRUE;
+        }
+    }
+    solver_context *solver = options->solver != NULL ? options->solver : createSolver();
+    unsigned char *resumedTiles = checkpoint.progress.active_tiles; // the progress is written over in the round
+    int status = FALSE;
+    if (solver == NULL)
+    {
+        fprintf(stderr, "%s", MEMORY_ERROR);
+    }
+    else
+    {
+        status = activateCalc(solver, n, m, sources, numOfSources, endingVal, iterationsNum, isCyclic,
+                              resumedCells != NULL ? resumedCells : initialCells, options, &checkpoint);
+    }
+    if (options->solver == NULL)
+    {
+        destroySolver(solver);
+    }
+    free(warmCells);
+    free(resumedCells);
+    free(resumedTiles);
+    return status;
+}
+
+/**
+ * this function reads a binary input file- its source points and initial grid are used where they are in the
+ * input
+ * @param input the input of the file we want to read
+ * @param options the options of the program
+ * @return TRUE for a successful reading, FALSE otherwise
+ */
+int readBinaryFile(input_cursor *input, const program_options *options)
+{
+    binary_input binary;
+    int status = loadBinaryInput(input->pos, (size_t) (input->end - input->pos), &binary);
+    if (status == -2)
+    {
+        fprintf(stderr, "%s", MEMORY_ERROR);
+        return FALSE;
+    }
+    if (status != 0)
+    {
+        return FALSE;
+    }
+    status = areSourcesInBoard(binary.n, binary.m, binary.sources, binary.num_sources) == FALSE ? FALSE :
+             runInput(binary.n, binary.m, binary.sources, binary.num_sources, binary.terminate, binary.n_iter,
+                      binary.is_cyclic, binary.cells, options);
+    freeBinaryInput(&binary);
+    return status;
+}
+
+/**
+ * this function reads the file given (text or binary, by its first bytes), analyzes the results and prints them
+ * @param input the input of the file we want to read
+ * @param options the options of the program
  * @return TRUE for a successful reading, FALSE otherwise
  */
-int readFile(FILE *file)
+int readFile(input_cursor *input, const program_options *options)
 {
+    if (isBinaryInput(input->pos, (size_t) (input->end - input->pos)))
+    {
+        return readBinaryFile(input, options);
+    }
     // parameters we want to read from the file:
     size_t n, m;
     source_point *sourcePoints = NULL;
@@ -406,51 +1021,371 @@ int readFile(FILE *file)
     unsigned int iterationsNum;
     int isCyclic;
 
-    if (readLines(file, &n, &m, &sourcePoints, &numOfSourcePoints, &endingVal, &iterationsNum, &isCyclic) == FALSE)
+    if (readLines(input, &n, &m, &sourcePoints, &numOfSourcePoints, &endingVal, &iterationsNum, &isCyclic) == FALSE)
     {
         free(sourcePoints);
         return FALSE;
     }
+    int status = runInput(n, m, sourcePoints, numOfSourcePoints, endingVal, iterationsNum, isCyclic, NULL,
+                          options);
+    free(sourcePoints);
+    return status;
+}
+
+/**
+ * this function reads a positive number (of threads, sweeps...) from the value of an option
+ * @param value the value of the option
+ * @param number the number pointer to init
+ * @return TRUE for a valid number and FALSE otherwise
+ */
+int parsePositive(const char *value, unsigned int *number)
+{
+    char *end;
+    long parsed = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || parsed <= 0)
+    {
+        return FALSE;
+    }
+    *number = (unsigned int) parsed;
+    return TRUE;
+}
 
-    double **grid;
-    if (buildGrid(&grid, n, m) == FALSE)
+/**
+ * this function reads the relaxation factor of SOR from the value of an option- a number between 0 and 2 or
+ * "auto"
+ * @param value the value of the option
+ * @param omega the relaxation factor pointer to init
+ * @return TRUE for a valid relaxation factor and FALSE otherwise
+ */
+int parseOmega(const char *value, double *omega)
+{
+    if (strcmp(value, AUTO_NAME) == 0)
+    {
+        *omega = AUTO_OMEGA;
+        return TRUE;
+    }
+    char *end;
+    double factor = strtod(value, &end);
+    if (end == value || *end != '\0' || factor <= 0 || factor >= MAX_OMEGA)
+    {
+        return FALSE;
+    }
+    *omega = factor;
+    return TRUE;
+}
+
+/**
+ * this function reads the threshold of the active tiles from the value of an option- a number that isn't
+ * negative (0 for updating all the cells)
+ * @param value the value of the option
+ * @param threshold the threshold pointer to init
+ * @return TRUE for a valid threshold and FALSE otherwise
+ */
+int parseThreshold(const char *value, double *threshold)
+{
+    char *end;
+    double parsed = strtod(value, &end);
+    if (end == value || *end != '\0' || !(parsed >= 0) || isinf(parsed))
     {
-        fprintf(stderr, "%s", MEMORY_ERROR);
-        freeGrid(&grid, numOfSourcePoints);
-        free(sourcePoints);
         return FALSE;
     }
-    initGrid(grid, n, m, sourcePoints, numOfSourcePoints);
-    activateCalc(heat_eqn, grid, n, m, sourcePoints, numOfSourcePoints, endingVal, iterationsNum, isCyclic);
+    *threshold = parsed;
     return TRUE;
 }
 
+/**
+ * this function reads a single command line option into the options of the program
+ * @param arg the option as given in the command line
+ * @param options the options of the program
+ * @return TRUE for a known option with a valid value and FALSE otherwise
+ */
+int parseOption(const char *arg, program_options *options)
+{
+    if (strncmp(arg, SCHEME_OPTION, strlen(SCHEME_OPTION)) == 0)
+    {
+        const char *scheme = arg + strlen(SCHEME_OPTION);
+        if (strcmp(scheme, GAUSS_SEIDEL_NAME) == 0)
+        {
+            options->calc.scheme = GAUSS_SEIDEL;
+            return TRUE;
+        }
+        if (strcmp(scheme, RED_BLACK_NAME) == 0)
+        {
+            options->calc.scheme = RED_BLACK;
+            return TRUE;
+        }
+        if (strcmp(scheme, JACOBI_NAME) == 0)
+        {
+            options->calc.scheme = JACOBI;
+            return TRUE;
+        }
+        if (strcmp(scheme, SOR_NAME) == 0)
+        {
+            options->calc.scheme = SOR;
+            return TRUE;
+        }
+        if (strcmp(scheme, MULTIGRID_NAME) == 0)
+        {
+            options->calc.scheme = MULTIGRID;
+            return TRUE;
+        }
+        return FALSE;
+    }
+    if (strncmp(arg, THREADS_OPTION, strlen(THREADS_OPTION)) == 0)
+    {
+        return parsePositive(arg + strlen(THREADS_OPTION), &options->calc.num_threads);
+    }
+    if (strncmp(arg, PROCESSES_OPTION, strlen(PROCESSES_OPTION)) == 0)
+    {
+        return parsePositive(arg + strlen(PROCESSES_OPTION), &options->calc.num_processes);
+    }
+    if (strncmp(arg, BLOCK_OPTION, strlen(BLOCK_OPTION)) == 0)
+    {
+        return parsePositive(arg + strlen(BLOCK_OPTION), &options->calc.block_sweeps);
+    }
+    if (strncmp(arg, SIMD_OPTION, strlen(SIMD_OPTION)) == 0)
+    {
+        int level;
+        for (level = SIMD_AUTO; level <= SIMD_AVX512; ++level)
+        {
+            if (strcmp(arg + strlen(SIMD_OPTION), SIMD_NAMES[level]) == 0)
+            {
+                options->calc.simd = (simd_level) level;
+                return TRUE;
+            }
+        }
+        return FALSE;
+    }
+    if (strncmp(arg, CONVERGENCE_OPTION, strlen(CONVERGENCE_OPTION)) == 0)
+    {
+        int policy;
+        for (policy = CHECK_HEAT; policy <= CHECK_PREDICTIVE; ++policy)
+        {
+            if (strcmp(arg + strlen(CONVERGENCE_OPTION), CONVERGENCE_NAMES[policy]) == 0)
+            {
+                options->calc.convergence = (convergence_policy) policy;
+                return TRUE;
+            }
+        }
+        return FALSE;
+    }
+    if (strncmp(arg, CHECK_EVERY_OPTION, strlen(CHECK_EVERY_OPTION)) == 0)
+    {
+        return parsePositive(arg + strlen(CHECK_EVERY_OPTION), &options->calc.check_every);
+    }
+    if (strncmp(arg, ASYNC_OUTPUT_OPTION, strlen(ASYNC_OUTPUT_OPTION)) == 0)
+    {
+        return parsePositive(arg + strlen(ASYNC_OUTPUT_OPTION), &options->output_queue);
+    }
+    if (strncmp(arg, WARM_START_OPTION, strlen(WARM_START_OPTION)) == 0)
+    {
+        options->warm_start_file = (char *) arg + strlen(WARM_START_OPTION);
+        return *options->warm_start_file != '\0' ? TRUE : FALSE;
+    }
+    if (strncmp(arg, TO_BINARY_OPTION, strlen(TO_BINARY_OPTION)) == 0)
+    {
+        options->binary_file = (char *) arg + strlen(TO_BINARY_OPTION);
+        return *options->binary_file != '\0' ? TRUE : FALSE;
+    }
+    if (strncmp(arg, CHECKPOINT_OPTION, strlen(CHECKPOINT_OPTION)) == 0)
+    {
+        options->checkpoint_file = (char *) arg + strlen(CHECKPOINT_OPTION);
+        return *options->checkpoint_file != '\0' ? TRUE : FALSE;
+    }
+    if (strncmp(arg, CHECKPOINT_EVERY_OPTION, strlen(CHECKPOINT_EVERY_OPTION)) == 0)
+    {
+        return parsePositive(arg + strlen(CHECKPOINT_EVERY_OPTION), &options->checkpoint_every);
+    }
+    if (strncmp(arg, CHECKPOINT_SWEEPS_OPTION, strlen(CHECKPOINT_SWEEPS_OPTION)) == 0)
+    {
+        return parsePositive(arg + strlen(CHECKPOINT_SWEEPS_OPTION), &options->checkpoint_sweeps);
+    }
+    if (strncmp(arg, STATS_OPTION, strlen(STATS_OPTION)) == 0)
+    {
+        options->stats_file = (char *) arg + strlen(STATS_OPTION);
+        return *options->stats_file != '\0' ? TRUE : FALSE;
+    }
+    if (strcmp(arg, RESUME_OPTION) == 0)
+    {
+        options->resume = 1;
+        return TRUE;
+    }
+    if (strncmp(arg, SNAPSHOTS_OPTION, strlen(SNAPSHOTS_OPTION)) == 0)
+    {
+        options->snapshot_file = (char *) arg + strlen(SNAPSHOTS_OPTION);
+        return *options->snapshot_file != '\0' ? TRUE : FALSE;
+    }
+    if (strncmp(arg, TILE_THRESHOLD_OPTION, strlen(TILE_THRESHOLD_OPTION)) == 0)
+    {
+        return parseThreshold(arg + strlen(TILE_THRESHOLD_OPTION), &options->calc.tile_threshold);
+    }
+    if (strncmp(arg, TILE_SIZE_OPTION, strlen(TILE_SIZE_OPTION)) == 0)
+    {
+        return parsePositive(arg + strlen(TILE_SIZE_OPTION), &options->calc.tile_size);
+    }
+    if (strncmp(arg, BATCH_OPTION, strlen(BATCH_OPTION)) == 0)
+    {
+        options->batch_dir = (char *) arg + strlen(BATCH_OPTION);
+        return *options->batch_dir != '\0' ? TRUE : FALSE;
+    }
+    if (strncmp(arg, WORKERS_OPTION, strlen(WORKERS_OPTION)) == 0)
+    {
+        return parsePositive(arg + strlen(WORKERS_OPTION), &options->batch_workers);
+    }
+    if (strncmp(arg, OMEGA_OPTION, strlen(OMEGA_OPTION)) == 0)
+    {
+        return parseOmega(arg + strlen(OMEGA_OPTION), &options->calc.omega);
+    }
+    return FALSE;
+}
+
+/**
+ * this function reads the command line- the options (starting with "--") and the file name
+ * @param argc the number of argument given
+ * @param argv the list of arguments
+ * @param options the options of the program to init
+ * @param fileName a pointer for the file name
+ * @return TRUE for a valid command line and FALSE otherwise (after printing the error)
+ */
+int parseArgs(int argc, char *argv[], program_options *options, char **fileName)
+{
+    int i, numOfArgs = 1;
+    initCalcOptions(&options->calc);
+    options->snapshot_file = NULL;
+    options->binary_file = NULL;
+    options->warm_start_file = NULL;
+    options->output_queue = 0;
+    options->checkpoint_file = NULL;
+    options->checkpoint_every = 1;
+    options->checkpoint_sweeps = DEFAULT_CHECKPOINT_SWEEPS;
+    options->resume = 0;
+    options->stats_file = NULL;
+    options->batch_dir = NULL;
+    options->batch_workers = 0;
+    options->output_file = NULL;
+    options->solver = NULL;
+    for (i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "--", 2) != 0)
+        {
+            *fileName = argv[i];
+            ++numOfArgs;
+        }
+        else if (parseOption(argv[i], options) == FALSE)
+        {
+            printf("%s", OPTION_ERROR);
+            return FALSE;
+        }
+    }
+    if (options->calc.convergence == CHECK_HEAT && options->calc.check_every > 1)
+    { // the heat difference is checked for free- skipping its checks would only run more sweeps
+        printf("%s", OPTION_ERROR);
+        return FALSE;
+    }
+    if (options->resume && options->checkpoint_file == NULL)
+    { // there is nothing to resume from
+        printf("%s", OPTION_ERROR);
+        return FALSE;
+    }
+    if (options->batch_dir != NULL && (options->snapshot_file != NULL || options->checkpoint_file != NULL ||
+                                       options->stats_file != NULL || options->binary_file != NULL))
+    { // the cases would all write the same file
+        printf("%s", OPTION_ERROR);
+        return FALSE;
+    }
+    if (numOfArgs != NUM_OF_ARGS)
+    {
+        printf("%s", ARGS_ERROR);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * this function solves a case of a batch- reads its input file and writes its output file (see case_solver)
+ * @param inputFile the input file of the case
+ * @param outputFile the output file of the case
+ * @param solver the solver of the worker
+ * @param context the options of the program
+ * @return 0 on success and -1 otherwise (after printing the error)
+ */
+int solveBatchCase(const char *inputFile, const char *outputFile, solver_context *solver, void *context)
+{
+    program_options options = *(const program_options *) context;
+    options.output_file = outputFile;
+    options.solver = solver;
+    input_cursor input;
+    if (openInput(inputFile, &input) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", inputFile, OPEN_FILE_ERROR);
+        return -1;
+    }
+    int status = readFile(&input, &options);
+    closeInput(&input);
+    if (status == FALSE)
+    {
+        fprintf(stderr, "%s: %s\n", inputFile, INPUT_FILE_ERROR);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * this function solves all the input files of a batch- the files in a directory or in a manifest- and reports
+ * its counts
+ * @param path the directory or the manifest of the batch
+ * @param options the options of the program
+ * @return TRUE if all the cases were solved and FALSE otherwise
+ */
+int runBatchFile(const char *path, const program_options *options)
+{
+    size_t numCases;
+    char **cases = listBatchCases(path, &numCases);
+    batch_report report;
+    if (cases == NULL || runBatch(cases, numCases, options->batch_dir, options->batch_workers, solveBatchCase,
+                                  (void *) options, &report) != 0)
+    {
+        fprintf(stderr, "%s", BATCH_ERROR);
+        freeBatchCases(cases, numCases);
+        return FALSE;
+    }
+    freeBatchCases(cases, numCases);
+    fprintf(stderr, "batch: %lu cases, %lu failed, %lu steals, %.3f seconds, %.1f cases per second\n",
+            report.cases, report.failed, report.steals, report.seconds,
+            report.seconds > 0 ? (double) report.cases / report.seconds : 0);
+    return report.failed == 0 ? TRUE : FALSE;
+}
+
 /**
  * the main function that runs the program
  * @param argc the number of argument given
- * @param argv the list of arguments- the file address
+ * @param argv the list of arguments- the options and the file address
  * @return 0 for proper run- 1 otherwise
  */
 int main(int argc, char *argv[])
 {
-    if (argc != NUM_OF_ARGS)
+    program_options options;
+    char *fileName;
+    if (parseArgs(argc, argv, &options, &fileName) == FALSE)
     {
-        printf("%s", ARGS_ERROR);
         return (1);
     }
-    char *fileName = argv[1];
-    FILE *file;
-    if ((file = fopen(fileName, "r")) == NULL) // open only for reading
+    if (options.batch_dir != NULL)
+    { // the file is the directory or the manifest of the batch
+        return runBatchFile(fileName, &options) == TRUE ? 0 : 1;
+    }
+    input_cursor input;
+    if (openInput(fileName, &input) != 0) // open only for reading
     {
         printf("%s", OPEN_FILE_ERROR);
         return (1);
     }
-    if (readFile(file) == FALSE)
+    if (readFile(&input, &options) == FALSE)
     {
         fprintf(stderr, "%s", INPUT_FILE_ERROR);
-        fclose(file);
+        closeInput(&input);
         return (1);
     }
-    fclose(file);
+    closeInput(&input);
     return 0;
 }
@@ -0,0 +1,155 @@
+/**
+ * @file simd_kernels.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * vectorized kernels of the built-in heat equation for the Jacobi sweep, chosen by the instructions the cpu has
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * a Jacobi sweep reads only the last grid, so a whole row of the next grid can be written 2 (SSE2), 4 (AVX2)
+ * or 8 (AVX-512) cells at a time. every kernel adds the same neighbors in the same order as heatEqnStencil,
+ * so all of them (and the scalar one) write exactly the same values.
+ * Input  : a row of the last grid
+ * Process: the heat equation on every cell of the row
+ * Output : the row of the next grid
+ */
+
+// ------------------------------ includes ------------------------------
+#include "sweep.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function writes a row of the next grid of a Jacobi sweep one cell at a time
+ * @param rowCells : the first cell of the row in the last grid
+ * @param nextCells : the first cell of the row in the next grid
+ * @param stride : the distance between two rows of the grids
+ * @param m : the number of cells in the row
+ */
+static void heatRowScalar(const double *rowCells, double *nextCells, size_t stride, size_t m)
+{
+    size_t col;
+    for (col = 0; col < m; ++col)
+    {
+        nextCells[col] = heatEqnStencil(rowCells[col + 1], rowCells[col + stride], rowCells[col - 1],
+                                        rowCells[col - stride]);
+    }
+}
+
+#ifdef HAS_X86_KERNELS
+
+/**
+ * this function writes a row of the next grid of a Jacobi sweep 2 cells at a time with SSE2
+ * (the parameters are the ones of heatRowScalar)
+ */
+__attribute__((target("sse2")))
+static void heatRowSse2(const double *rowCells, double *nextCells, size_t stride, size_t m)
+{
+    const __m128d quarter = _mm_set1_pd(0.25);
+    size_t col;
+    for (col = 0; col + 2 <= m; col += 2)
+    {
+        __m128d dphiDx = _mm_add_pd(_mm_loadu_pd(rowCells + col + 1), _mm_loadu_pd(rowCells + col - 1));
+        __m128d dphiDy = _mm_add_pd(_mm_loadu_pd(rowCells + col + stride), _mm_loadu_pd(rowCells + col - stride));
+        _mm_storeu_pd(nextCells + col, _mm_mul_pd(_mm_add_pd(dphiDx, dphiDy), quarter));
+    }
+    heatRowScalar(rowCells + col, nextCells + col, stride, m - col);
+}
+
+/**
+ * this function writes a row of the next grid of a Jacobi sweep 4 cells at a time with AVX2
+ * (the parameters are the ones of heatRowScalar)
+ */
+__attribute__((target("avx2")))
+static void heatRowAvx2(const double *rowCells, double *nextCells, size_t stride, size_t m)
+{
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    size_t col;
+    for (col = 0; col + 4 <= m; col += 4)
+    {
+        __m256d dphiDx = _mm256_add_pd(_mm256_loadu_pd(rowCells + col + 1), _mm256_loadu_pd(rowCells + col - 1));
+        __m256d dphiDy = _mm256_add_pd(_mm256_loadu_pd(rowCells + col + stride),
+                                       _mm256_loadu_pd(rowCells + col - stride));
+        _mm256_storeu_pd(nextCells + col, _mm256_mul_pd(_mm256_add_pd(dphiDx, dphiDy), quarter));
+    }
+    heatRowScalar(rowCells + col, nextCells + col, stride, m - col);
+}
+
+/**
+ * this function writes a row of the next grid of a Jacobi sweep 8 cells at a time with AVX-512
+ * (the parameters are the ones of heatRowScalar)
+ */
+__attribute__((target("avx512f")))
+static void heatRowAvx512(const double *rowCells, double *nextCells, size_t stride, size_t m)
+{
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    size_t col;
+    for (col = 0; col + 8 <= m; col += 8)
+    {
+        __m512d dphiDx = _mm512_add_pd(_mm512_loadu_pd(rowCells + col + 1), _mm512_loadu_pd(rowCells + col - 1));
+        __m512d dphiDy = _mm512_add_pd(_mm512_loadu_pd(rowCells + col + stride),
+                                       _mm512_loadu_pd(rowCells + col - stride));
+        _mm512_storeu_pd(nextCells + col, _mm512_mul_pd(_mm512_add_pd(dphiDx, dphiDy), quarter));
+    }
+    heatRowScalar(rowCells + col, nextCells + col, stride, m - col);
+}
+
+#endif
+
+/**
+ * this function finds the widest instructions the cpu has, up to the given ones
+ * @param limit : the widest instructions to use (SIMD_AUTO for no limit)
+ * @return the instructions to use
+ */
+simd_level detectSimdLevel(simd_level limit)
+{
+    simd_level level = SIMD_SCALAR;
+#ifdef HAS_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        level = SIMD_SSE2;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        level = SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        level = SIMD_AVX512;
+    }
+#endif
+    return limit != SIMD_AUTO && limit < level ? limit : level;
+}
+
+/**
+ * this function chooses the Jacobi row kernel of the built-in heat equation for the cpu
+ * @param limit : the widest instructions to use (SIMD_AUTO for no limit)
+ * @return the kernel
+ */
+heat_row_kernel selectHeatRowKernel(simd_level limit)
+{
+    switch (detectSimdLevel(limit))
+    {
+#ifdef HAS_X86_KERNELS
+        case SIMD_AVX512:
+            return heatRowAvx512;
+        case SIMD_AVX2:
+            return heatRowAvx2;
+        case SIMD_SSE2:
+            return heatRowSse2;
+#endif
+        default:
+            return heatRowScalar;
+    }
+}
@@ -0,0 +1,273 @@
+/**
+ * @file solver.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * a reusable solver of the heat equation, with all its memory in a single arena
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * a service that solves grid after grid pays for a malloc and a free of the grid, the source mask and the
+ * scratch buffers of every calculation. a solver_context keeps all of them in one block (an arena)- configuring
+ * it lays them out in the arena, which is only replaced when it is too small, so solving again with the same
+ * dimensions and options allocates nothing.
+ * the layout is run twice- once on an arena with no block, which only counts the size of the allocations, and
+ * once on the reserved block- so the size is never computed apart from the layout itself.
+ * Input  : the dimensions and the options of a calculation, its cells and its source points
+ * Process: lay out the memory in the arena and run the rounds in it
+ * Output : the grid after every round and the heat difference of the round
+ */
+
+// ------------------------------ includes ------------------------------
+#include <string.h>
+#include "sweep.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * @brief the state of a solver- the calculation it is configured for and the memory laid out in its arena
+ */
+struct solver_context
+{
+    diff_func function;
+    calc_options options;
+    size_t n, m, stride;
+    double terminate;
+    unsigned int n_iter;
+    int is_cyclic;
+    /** the strided grid in the arena, or NULL while the solver isn't configured */
+    double *grid;
+    round_scratch scratch;
+    calc_arena arena;
+};
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function inits an arena with no block- it only counts the size of the allocations
+ * @param arena : the arena to init
+ */
+void initArena(calc_arena *arena)
+{
+    arena->block = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+/**
+ * this function makes sure the block of an arena has at least the given size, and empties it. the block is only
+ * replaced when it is too small.
+ * @param arena : the arena
+ * @param size : the size in bytes
+ * @return 0 on success and -1 if the memory couldn't be allocated (the arena is then left with no block)
+ */
+int reserveArena(calc_arena *arena, size_t size)
+{
+    arena->used = 0;
+    if (arena->block != NULL && arena->size >= size)
+    {
+        return 0;
+    }
+    freeArena(arena);
+    void *block;
+    if (posix_memalign(&block, GRID_ALIGNMENT, size > 0 ? size : GRID_ALIGNMENT) != 0)
+    {
+        return -1;
+    }
+    arena->block = (char *) block;
+    arena->size = size;
+    return 0;
+}
+
+/**
+ * this function takes memory from an arena- the allocations are aligned to GRID_ALIGNMENT, so the rows of a
+ * grid in the arena start cache lines like the ones of allocStridedGrid
+ * @param arena : the arena
+ * @param size : the size in bytes
+ * @return the memory, or NULL if the arena has no block (the size is only counted) or it is full
+ */
+void *arenaAlloc(calc_arena *arena, size_t size)
+{
+    size_t aligned = (size + GRID_ALIGNMENT - 1) / GRID_ALIGNMENT * GRID_ALIGNMENT;
+    if (arena->block == NULL)
+    {
+        arena->used += aligned;
+        return NULL;
+    }
+    if (aligned > arena->size - arena->used)
+    {
+        return NULL;
+    }
+    void *memory = arena->block + arena->used;
+    arena->used += aligned;
+    return memory;
+}
+
+/**
+ * this function frees the block of an arena
+ * @param arena : the arena
+ */
+void freeArena(calc_arena *arena)
+{
+    free(arena->block);
+    initArena(arena);
+}
+
+/**
+ * this function creates a solver that isn't configured yet
+ * @return the solver, or NULL if the memory couldn't be allocated
+ */
+solver_context *createSolver(void)
+{
+    solver_context *solver = (solver_context *) malloc(sizeof(solver_context));
+    if (solver == NULL)
+    {
+        return NULL;
+    }
+    initArena(&solver->arena);
+    solver->grid = NULL;
+    solver->n = 0;
+    solver->m = 0;
+    return solver;
+}
+
+/**
+ * this function lays out the memory of a solver in an arena- the grid first and the scratch of the rounds
+ * after it
+ * @param solver : the solver, with the calculation it is configured for
+ * @param arena : the arena
+ */
+void layoutSolver(solver_context *solver, calc_arena *arena)
+{
+    size_t size = stridedGridSize(solver->n, solver->m, &solver->stride);
+    void *block = arenaAlloc(arena, size * sizeof(double));
+    solver->grid = block != NULL ? gridInBlock(block, solver->stride) : NULL;
+    layoutRoundScratch(&solver->scratch, arena, solver->function, solver->n, solver->m, solver->n_iter,
+                       solver->is_cyclic, &solver->options);
+}
+
+/**
+ * this function configures a solver for a calculation- lays out its memory in the arena (a new one, if the
+ * arena is too small) with a zeroed grid and no source points
+ * @param solver : the solver
+ * @param function : the function that calculates the new value of the cell
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param terminate : the termination value
+ * @param n_iter : the number of iterations given
+ * @param is_cyclic : 1 if its cyclic and 0 if its not
+ * @param options : the options of the calculation, or NULL for the defaults
+ * @return 0 on success and -1 if the memory couldn't be allocated
+ */
+int configureSolver(solver_context *solver, diff_func function, size_t n, size_t m, double terminate,
+                    unsigned int n_iter, int is_cyclic, const calc_options *options)
+{
+    solver->function = function;
+    if (options != NULL)
+    {
+        solver->options = *options;
+    }
+    else
+    {
+        initCalcOptions(&solver->options);
+    }
+    solver->n = n;
+    solver->m = m;
+    solver->terminate = terminate;
+    solver->n_iter = n_iter;
+    solver->is_cyclic = is_cyclic;
+    calc_arena counter;
+    initArena(&counter);
+    layoutSolver(solver, &counter);
+    if (reserveArena(&solver->arena, counter.used) != 0)
+    {
+        solver->grid = NULL;
+        return -1;
+    }
+    layoutSolver(solver, &solver->arena);
+    memset(solver->arena.block, 0, solver->arena.used);
+    return 0;
+}
+
+/**
+ * this function sets the cells of the grid of a solver
+ * @param solver : the configured solver
+ * @param cells : the cells (n * m in row major order), or NULL for zeros
+ */
+void setSolverCells(solver_context *solver, const double *cells)
+{
+    size_t row;
+    for (row = 0; row < solver->n; ++row)
+    {
+        double *rowCells = solver->grid + row * solver->stride;
+        if (cells != NULL)
+        {
+            memcpy(rowCells, cells + row * solver->m, solver->m * sizeof(double));
+        }
+        else
+        {
+            memset(rowCells, 0, solver->m * sizeof(double));
+        }
+    }
+}
+
+/**
+ * this function sets the source points of a solver- their values in the grid and the source mask
+ * @param solver : the configured solver
+ * @param sources : the list of the source points (on the board)
+ * @param num_sources : the number of source points
+ */
+void setSolverSources(solver_context *solver, const source_point *sources, size_t num_sources)
+{
+    markSources(solver->scratch.sourceMask, solver->n, solver->m, sources, num_sources);
+    size_t i;
+    for (i = 0; i < num_sources; ++i)
+    {
+        solver->grid[sources[i].x * solver->stride + sources[i].y] = sources[i].value;
+    }
+}
+
+/**
+ * this function runs a round of the calculation a solver is configured for- the first one goes on from the
+ * resume of the options
+ * @param solver : the configured solver
+ * @return the heat difference in the round, or a negative value if an engine couldn't allocate its memory
+ */
+double runSolver(solver_context *solver)
+{
+    double result = calculateRound(solver->function, solver->grid, solver->stride, solver->n, solver->m,
+                                   &solver->scratch, solver->terminate, solver->n_iter, solver->is_cyclic,
+                                   &solver->options);
+    solver->options.resume = NULL; // the next rounds start over
+    return result;
+}
+
+/**
+ * this function gives the grid of a solver
+ * @param solver : the configured solver
+ * @param stride : the pointer for the distance between two rows of the grid
+ * @return the strided grid
+ */
+double *getSolverGrid(const solver_context *solver, size_t *stride)
+{
+    *stride = solver->stride;
+    return solver->grid;
+}
+
+/**
+ * this function frees a solver and its arena
+ * @param solver : the solver, or NULL
+ */
+void destroySolver(solver_context *solver)
+{
+    if (solver == NULL)
+    {
+        return;
+    }
+    freeArena(&solver->arena);
+    free(solver);
+}
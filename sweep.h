@@ -0,0 +1,355 @@
+/*
+ * sweep.h
+ *
+ * The pieces shared by the calculator and its iteration engines.
+ */
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <tgmath.h>
+#include "calculator.h"
+#include "heat_eqn.h"
+
+/**
+ * A running sum of heat. By default it is the plain sum of the values in the order they are added, the way the
+ * calculator always summed the grid, so a round reports exactly the same heat difference. Built with
+ * COMPENSATED_HEAT_SUM it also carries the rounding error of the additions (Neumaier's variant of Kahan's
+ * summation), so the sum of a large grid doesn't drift- the heat differences then change in their last bits.
+ */
+typedef struct
+{
+    double sum, compensation;
+} heat_sum;
+
+/**
+ * Adds a value to a heat_sum held in the local variables sum and compensation.
+ */
+#ifdef COMPENSATED_HEAT_SUM
+#define ADD_HEAT(sum, compensation, value) \
+do \
+{ \
+    double addedValue_ = (value); \
+    double newSum_ = (sum) + addedValue_; \
+    (compensation) += fabs(sum) >= fabs(addedValue_) ? ((sum) - newSum_) + addedValue_ \
+                                                     : (addedValue_ - newSum_) + (sum); \
+    (sum) = newSum_; \
+} while (0)
+#else
+#define ADD_HEAT(sum, compensation, value) \
+do \
+{ \
+    (sum) += (value); \
+    (void) (compensation); \
+} while (0)
+#endif
+
+/**
+ * Defines a function that updates every STEP-th cell of a run of cells in a row that has all its neighbors in
+ * place (in the grid or in the halo), reading the four neighbors of every cell directly and applying
+ * STENCIL(right, top, left, bottom). The new value of every visited cell (source points included) is added to
+ * the heat sum on the way. Every stencil gets its own kernel so that the built-in one is inlined into the loop.
+ * The defined function gets:
+ * function : the function that calculates the new value of the cell (used when it is the stencil)
+ * rowCells : the first cell of the row in the strided grid
+ * stride : the distance between two rows of the grid
+ * rowMask : the source mask of the row
+ * from : the first column to update
+ * to : the column after the last one to update
+ * heat : the heat sum of the sweep
+ */
+#define DEFINE_RUN_KERNEL(name, STENCIL, STEP) \
+static void name(diff_func function, double *rowCells, size_t stride, const unsigned char *rowMask, size_t from, \
+                 size_t to, heat_sum *heat) \
+{ \
+    size_t col; \
+    double sum = heat->sum, compensation = heat->compensation; \
+    (void) function; \
+    for (col = from; col < to; col += (STEP)) \
+    { \
+        if (!rowMask[col]) \
+        { \
+            rowCells[col] = STENCIL(rowCells[col + 1], rowCells[col + stride], rowCells[col - 1], \
+                                    rowCells[col - stride]); \
+        } \
+        ADD_HEAT(sum, compensation, rowCells[col]); \
+    } \
+    heat->sum = sum; \
+    heat->compensation = compensation; \
+}
+
+/**
+ * A bump allocator over a single aligned block. While it has no block it only counts the size of the
+ * allocations, so a layout is run once to find the size of the block and once more to place it in the block.
+ */
+typedef struct
+{
+    char *block;
+    size_t size, used;
+} calc_arena;
+
+/**
+ * Inits an arena with no block.
+ */
+void initArena(calc_arena *arena);
+
+/**
+ * Makes sure the block of the arena has at least size bytes (it only grows) and empties it. Returns 0 on
+ * success and -1 if the memory couldn't be allocated.
+ */
+int reserveArena(calc_arena *arena, size_t size);
+
+/**
+ * Takes size bytes aligned to GRID_ALIGNMENT from the arena. Returns NULL while it has no block (only counting)
+ * or if the block is full.
+ */
+void *arenaAlloc(calc_arena *arena, size_t size);
+
+/**
+ * Frees the block of the arena.
+ */
+void freeArena(calc_arena *arena);
+
+/**
+ * Returns the size in doubles of the block of a strided grid, and its stride.
+ */
+size_t stridedGridSize(size_t n, size_t m, size_t *stride);
+
+/**
+ * Returns the cell (0, 0) of a strided grid placed in the given block (of stridedGridSize doubles).
+ */
+double *gridInBlock(void *block, size_t stride);
+
+/**
+ * Fills the source mask of the grid- n * m flags in row major order, set for the source points.
+ */
+void markSources(unsigned char *mask, size_t n, size_t m, const source_point *sources, size_t num_sources);
+
+/**
+ * Zeroes the halo around the grid, so the neighbors out of the board are read as zero.
+ */
+void clearHalo(double *grid, size_t stride, size_t n, size_t m);
+
+/**
+ * Copies the wrapped rows and columns of a cyclic grid into its halo, as they are right now.
+ */
+void wrapHalo(double *grid, size_t stride, size_t n, size_t m);
+
+/**
+ * Sums all the values in the grid, the same way the sweeps sum them.
+ */
+double getSumOfHeat(const double *grid, size_t stride, size_t n, size_t m);
+
+/**
+ * Updates the cells from to to (not included) of a row that has all its neighbors in place, in the order of
+ * the sweep, and adds them to the heat sum- over-relaxed by omega if it isn't 1.
+ */
+void updateRun(diff_func function, double *rowCells, size_t stride, const unsigned char *rowMask, size_t from,
+               size_t to, double omega, heat_sum *heat);
+
+/**
+ * Runs a single in place Gauss-Seidel sweep (over-relaxed by omega, if it isn't 1) on the grid.
+ * Returns the heat of the grid after the sweep.
+ */
+double updateAllValues(diff_func function, double *grid, size_t stride, size_t n, size_t m, int isCyclic,
+                       const unsigned char *sourceMask, double omega);
+
+/**
+ * The active tiles of an in place sweep- the grid is split to square tiles, and a tile is only updated while
+ * the largest change of a cell in it, or in one of its four neighbor tiles, was at least the threshold in the
+ * last sweep, or a tile it reads changed that much earlier in this sweep.
+ */
+typedef struct
+{
+    double threshold;
+    size_t tileSize, tileRows, tileCols;
+    /** if every tile is updated in the next sweep, and if it changed at least by the threshold in the last one */
+    unsigned char *active, *loud;
+    /** the largest change of a cell of every tile in the sweep */
+    double *change;
+    /** the cells of the run being updated, as they were before the update */
+    double *before;
+    /** the number of tile updates run and skipped */
+    unsigned long updated, skipped;
+} tile_tracker;
+
+/**
+ * Lays out the active tiles of an n x m grid in the arena (see calc_arena).
+ */
+void layoutTileTracker(tile_tracker *tiles, calc_arena *arena, double threshold, unsigned int tileSize, size_t n,
+                       size_t m);
+
+/**
+ * Makes all the tiles active, for a new round.
+ */
+void resetTileTracker(tile_tracker *tiles);
+
+/**
+ * Runs a single in place sweep like updateAllValues, on the active tiles only, and finds the tiles of the next
+ * sweep. Returns the heat of the grid after the sweep.
+ */
+double updateActiveTiles(diff_func function, double *grid, size_t stride, size_t n, size_t m, int isCyclic,
+                         const unsigned char *sourceMask, double omega, tile_tracker *tiles);
+
+/**
+ * The convergence check of a calculation until terminate- its policy and where it is.
+ */
+typedef struct
+{
+    convergence_policy policy;
+    unsigned int checkEvery;
+    double terminate;
+    size_t n, m;
+    /** the cells (n * m in row major order) before a checked sweep, for the norms of the change, or NULL */
+    double *before;
+    /** the sweeps done, the checks done and the sweep the next check is after */
+    unsigned long sweeps, checks, nextCheck;
+    /** the measure of the last check and of the check before it (negative before there was one), and its sweep */
+    double metric, lastMetric;
+    unsigned long lastCheck;
+    /** the function told where the round is every progressEvery sweeps (see progress_func), or NULL */
+    progress_func onProgress;
+    void *progressContext;
+    unsigned int progressEvery;
+    /** the active tiles of the round, or NULL */
+    const tile_tracker *tiles;
+    /** 1 if the round goes on from where it was stopped, with the heat of the grid there, and 0 otherwise */
+    int isResumed;
+    double resumedHeat;
+} convergence_check;
+
+/**
+ * Inits the convergence check of a calculation until terminate with the policy in the options (with n_iter
+ * above zero it isn't used). before is room for n * m cells, for the policies that copy the grid (see
+ * needsGridCopy).
+ */
+void initConvergence(convergence_check *check, const calc_options *options, double terminate, unsigned int n_iter,
+                     size_t n, size_t m, double *before);
+
+/**
+ * Returns 1 if the convergence check of the options copies the grid before a checked sweep, and 0 otherwise.
+ */
+int needsGridCopy(const calc_options *options, unsigned int n_iter);
+
+/**
+ * Makes the check (and the active tiles, if not NULL) go on from where a round was stopped.
+ */
+void resumeConvergence(convergence_check *check, const round_progress *progress, tile_tracker *tiles);
+
+/**
+ * Returns the heat of the grid a round starts from- the heat the round was stopped with, if it is resumed.
+ */
+double roundStartHeat(const convergence_check *check, const double *grid, size_t stride, size_t n, size_t m);
+
+/**
+ * Gets ready for the next sweep- copies the grid if the sweep is checked with a norm.
+ */
+void prepareSweep(convergence_check *check, const double *grid, size_t stride);
+
+/**
+ * Counts a sweep that changed the heat from initialHeat to currHeat, and checks the convergence if it's time.
+ * Returns 1 if the calculation is over and 0 otherwise (after telling the progress function where it is, if it's
+ * time).
+ */
+int finishSweep(convergence_check *check, const double *grid, size_t stride, double initialHeat, double currHeat);
+
+/**
+ * Adds the counts of the check to the report (if it isn't NULL).
+ */
+void endConvergence(convergence_check *check, convergence_report *report);
+
+/**
+ * Returns the time in seconds of a monotonic clock, for the statistics of a calculation.
+ */
+double statsSeconds(void);
+
+/**
+ * Adds the record of a sweep (or a pass of sweeps) to the statistics- the update of the cells ran from start to
+ * reductionStart and changed the heat from initialHeat to currHeat. The residual of the grid is found here, as
+ * part of the reduction.
+ */
+void recordSweep(calc_stats *stats, diff_func function, const double *grid, size_t stride, size_t n, size_t m,
+                 const unsigned char *sourceMask, int isCyclic, unsigned int sweeps, double start,
+                 double reductionStart, double initialHeat, double currHeat);
+
+/**
+ * The red-black and Jacobi engines- see calculateWithOptions. They run n_iter sweeps, or until the convergence
+ * check says the calculation is over when n_iter is 0. Returns a negative value if the memory can't be
+ * allocated.
+ */
+double calculateParallel(diff_func function, double *grid, size_t stride, size_t n, size_t m,
+                         const unsigned char *sourceMask, convergence_check *check, unsigned int n_iter,
+                         int is_cyclic, iteration_scheme scheme, unsigned int num_threads, simd_level simd, calc_stats *stats);
+
+/**
+ * The distributed Jacobi engine- see calculateWithOptions. The rows are split between num_processes worker
+ * processes (with statistics, a norm of the change, a progress function or workers that can't be started it runs
+ * calculateParallel on num_threads threads). Returns a negative value if the memory can't be allocated.
+ */
+double calculateDistributed(diff_func function, double *grid, size_t stride, size_t n, size_t m,
+                            const unsigned char *sourceMask, convergence_check *check, unsigned int n_iter,
+                            int is_cyclic, unsigned int num_processes, unsigned int num_threads, simd_level simd,
+                            calc_stats *stats);
+
+/**
+ * A kernel that writes a row of the next grid of a Jacobi sweep with the built-in heat equation- every one of
+ * the m cells of nextCells gets heatEqnStencil of its neighbors in rowCells (source points included).
+ */
+typedef void (*heat_row_kernel)(const double *rowCells, double *nextCells, size_t stride, size_t m);
+
+/**
+ * Returns the widest instructions the cpu has, up to the given limit (SIMD_AUTO for no limit).
+ */
+simd_level detectSimdLevel(simd_level limit);
+
+/**
+ * Returns the heat_row_kernel for the widest instructions the cpu has, up to the given limit. All the kernels
+ * write identical values.
+ */
+heat_row_kernel selectHeatRowKernel(simd_level limit);
+
+/**
+ * Writes a row of the next grid of a Jacobi sweep from the row of the last grid with the given function (or
+ * with the kernel of the built-in heat equation), keeping the source points, and adds it to the heat sum.
+ */
+void jacobiFunctionRow(diff_func function, const double *rowCells, double *nextCells, size_t stride,
+                       const unsigned char *rowMask, size_t m, heat_sum *heat);
+void jacobiHeatRow(heat_row_kernel heatRow, const double *rowCells, double *nextCells, size_t stride,
+                   const unsigned char *rowMask, size_t m, heat_sum *heat);
+
+/**
+ * The multigrid engine of the built-in heat equation- see calculateWithOptions. Returns a negative value if the
+ * memory can't be allocated.
+ */
+double calculateMultigrid(double *grid, size_t stride, size_t n, size_t m, const unsigned char *sourceMask,
+                          convergence_check *check, unsigned int n_iter, int is_cyclic, calc_stats *stats);
+
+/**
+ * The memory a round of the calculation works with, laid out in an arena.
+ */
+typedef struct
+{
+    /** the source mask of the grid */
+    unsigned char *sourceMask;
+    /** the copy of the grid for the convergence check, or NULL if it isn't copied */
+    double *before;
+    /** the heat sums of a pass of block_sweeps sweeps, or NULL if the sweeps don't run in blocks */
+    heat_sum *blockHeat;
+    /** the active tiles, or NULL if all the cells are updated */
+    tile_tracker tiles, *activeTiles;
+} round_scratch;
+
+/**
+ * Lays out the memory of a round of the calculation in the arena (see calc_arena).
+ */
+void layoutRoundScratch(round_scratch *scratch, calc_arena *arena, diff_func function, size_t n, size_t m,
+                        unsigned int n_iter, int is_cyclic, const calc_options *options);
+
+/**
+ * Runs a round of the calculation with the memory of the scratch, whose source mask is filled. Returns the
+ * heat difference in the round (see calculateWithOptions), or a negative value if an engine couldn't allocate
+ * its memory.
+ */
+double calculateRound(diff_func function, double *grid, size_t stride, size_t n, size_t m, round_scratch *scratch,
+                      double terminate, unsigned int n_iter, int is_cyclic, const calc_options *options);
+
+#endif
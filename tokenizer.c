@@ -0,0 +1,522 @@
+/**
+ * @file tokenizer.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * a zero-copy reader of the input file, with the conversions of fscanf
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * the input file is mapped to memory (or read whole when it can't be mapped, like a pipe) and read through a
+ * cursor. the numbers are converted in place, with no copy and no stream locking- the conversions read and
+ * leave exactly the characters fscanf reads and leaves, so the reader validates the file as it did with fscanf.
+ * a decimal number with up to 15 significant digits and a power of ten up to 10^22 is converted with a single
+ * double operation (Clinger's fast path)- its digits and the power of ten are both exact doubles, so the one
+ * rounding gives the double strtod gives. the other numbers are copied to a buffer and converted by strtod.
+ * Input  : the input file
+ * Process: map the file and convert its words
+ * Output : the numbers of the file
+ */
+
+// ------------------------------ includes ------------------------------
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tokenizer.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * the size of the first buffer of an input that is read instead of mapped (it doubles when it fills)
+ */
+#define READ_BUFFER_SIZE (1 << 16)
+
+/**
+ * the size of the buffer a word is copied to for strtod (longer words are copied to the heap)
+ */
+#define WORD_BUFFER_SIZE 64
+
+/**
+ * the mantissas up to that are exact doubles (2^53)
+ */
+#define FAST_MANTISSA_LIMIT 9007199254740992LL
+
+/**
+ * the largest power of ten that is an exact double
+ */
+#define FAST_MAX_POWER 22
+
+/**
+ * the exact powers of ten in double
+ */
+static const double POWERS_OF_TEN[FAST_MAX_POWER + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                                         1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+                                                         1e20, 1e21, 1e22};
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function reads the whole file to the heap, for files that can't be mapped
+ * @param fd : the file descriptor of the file
+ * @param input : the input to init
+ * @return 0 on success and -1 if the memory couldn't be allocated
+ */
+int readWholeFile(int fd, input_cursor *input)
+{
+    size_t capacity = READ_BUFFER_SIZE, length = 0;
+    char *data = (char *) malloc(capacity);
+    if (data == NULL)
+    {
+        return -1;
+    }
+    ssize_t bytes;
+    while ((bytes = read(fd, data + length, capacity - length)) > 0)
+    {
+        length += (size_t) bytes;
+        if (length == capacity)
+        {
+            char *larger = (char *) realloc(data, capacity * 2);
+            if (larger == NULL)
+            {
+                free(data);
+                return -1;
+            }
+            data = larger;
+            capacity *= 2;
+        }
+    } // a read error ends the input, like it ends fscanf
+    input->data = data;
+    input->pos = data;
+    input->end = data + length;
+    input->mappedSize = 0;
+    return 0;
+}
+
+/**
+ * this function opens the given file for reading- maps it to memory, or reads it whole if it can't be mapped
+ * @param fileName : the name of the file
+ * @param input : the input to init
+ * @return 0 on success and -1 if the file couldn't be opened
+ */
+int openInput(const char *fileName, input_cursor *input)
+{
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+        size_t size = (size_t) info.st_size;
+        void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            madvise(data, size, MADV_SEQUENTIAL);
+            close(fd);
+            input->data = (const char *) data;
+            input->pos = input->data;
+            input->end = input->data + size;
+            input->mappedSize = size;
+            return 0;
+        }
+    }
+    int status = readWholeFile(fd, input);
+    close(fd);
+    return status;
+}
+
+/**
+ * this function releases the bytes of an input
+ * @param input : the input to close
+ */
+void closeInput(input_cursor *input)
+{
+    if (input->mappedSize > 0)
+    {
+        munmap((void *) input->data, input->mappedSize);
+    }
+    else
+    {
+        free((void *) input->data);
+    }
+    input->data = input->pos = input->end = NULL;
+}
+
+/**
+ * this function skips white space
+ * @param input : the input
+ */
+void skipSpaces(input_cursor *input)
+{
+    while (input->pos < input->end && isspace((unsigned char) *input->pos))
+    {
+        ++input->pos;
+    }
+}
+
+/**
+ * this function skips white space and reads the given character
+ * @param input : the input
+ * @param expected : the character
+ * @return 1 if it was read and 0 otherwise
+ */
+int scanLiteral(input_cursor *input, char expected)
+{
+    skipSpaces(input);
+    if (input->pos < input->end && *input->pos == expected)
+    {
+        ++input->pos;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * this function reads an int like "%d" of fscanf- a number too large for a long is cut to its limit, and the
+ * long is cut to an int
+ * @param input : the input
+ * @param value : the int pointer to init
+ * @return 1 if it was read and 0 otherwise
+ */
+int scanInt(input_cursor *input, int *value)
+{
+    skipSpaces(input);
+    const char *pos = input->pos;
+    int isNegative = 0;
+    if (pos < input->end && (*pos == '+' || *pos == '-'))
+    {
+        isNegative = *pos == '-';
+        input->pos = ++pos; // fscanf doesn't give the sign back
+    }
+    if (pos == input->end || !isdigit((unsigned char) *pos))
+    {
+        return 0;
+    }
+    long number = 0;
+    int isOverflow = 0;
+    for (; pos < input->end && isdigit((unsigned char) *pos); ++pos)
+    {
+        int digit = *pos - '0';
+        if (number > (LONG_MAX - digit) / 10)
+        {
+            isOverflow = 1;
+        }
+        else
+        {
+            number = number * 10 + digit;
+        }
+    }
+    input->pos = pos;
+    if (isOverflow)
+    {
+        number = isNegative ? LONG_MIN : LONG_MAX;
+    }
+    else if (isNegative)
+    {
+        number = -number;
+    }
+    *value = (int) number;
+    return 1;
+}
+
+/**
+ * this function checks if the given (case insensitive) word starts at pos
+ * @param pos : the place to check
+ * @param end : the end of the input
+ * @param word : the word, in lower case
+ * @return the length of the word if it's there and 0 otherwise
+ */
+size_t matchWord(const char *pos, const char *end, const char *word)
+{
+    size_t length = strlen(word), i;
+    if ((size_t) (end - pos) < length)
+    {
+        return 0;
+    }
+    for (i = 0; i < length; ++i)
+    {
+        if (tolower((unsigned char) pos[i]) != word[i])
+        {
+            return 0;
+        }
+    }
+    return length;
+}
+
+/**
+ * this function finds the length of the floating point number (after the sign) that starts at pos, in the forms
+ * strtod reads- decimal or hexadecimal with an optional exponent, infinity and nan
+ * @param pos : the beginning of the number
+ * @param end : the end of the input
+ * @return the length of the number, or 0 if there is no number
+ */
+size_t numberLength(const char *pos, const char *end)
+{
+    const char *start = pos;
+    size_t length;
+    if ((length = matchWord(pos, end, "infinity")) > 0 || (length = matchWord(pos, end, "inf")) > 0)
+    {
+        return length;
+    }
+    if ((length = matchWord(pos, end, "nan")) > 0)
+    {
+        pos += length;
+        if (pos < end && *pos == '(')
+        { // nan(chars)
+            const char *close = pos + 1;
+            while (close < end && (isalnum((unsigned char) *close) || *close == '_'))
+            {
+                ++close;
+            }
+            if (close < end && *close == ')')
+            {
+                pos = close + 1;
+            }
+        }
+        return (size_t) (pos - start);
+    }
+    int isHex = end - pos > 2 && pos[0] == '0' && (pos[1] == 'x' || pos[1] == 'X') &&
+                (isxdigit((unsigned char) pos[2]) || (pos[2] == '.' && end - pos > 3 &&
+                                                      isxdigit((unsigned char) pos[3])));
+    int (*isDigit)(int) = isHex ? isxdigit : isdigit;
+    size_t digits = 0;
+    if (isHex)
+    {
+        pos += 2;
+    }
+    for (; pos < end && isDigit((unsigned char) *pos); ++pos, ++digits);
+    if (pos < end && *pos == '.')
+    {
+        for (++pos; pos < end && isDigit((unsigned char) *pos); ++pos, ++digits);
+    }
+    if (digits == 0)
+    {
+        return 0;
+    }
+    if (pos < end && (isHex ? (*pos == 'p' || *pos == 'P') : (*pos == 'e' || *pos == 'E')))
+    { // the exponent counts only if it has digits
+        const char *exponent = pos + 1;
+        if (exponent < end && (*exponent == '+' || *exponent == '-'))
+        {
+            ++exponent;
+        }
+        if (exponent < end && isdigit((unsigned char) *exponent))
+        {
+            for (pos = exponent; pos < end && isdigit((unsigned char) *pos); ++pos);
+        }
+    }
+    return (size_t) (pos - start);
+}
+
+/**
+ * this function finds the length of an exponent with no digits after a number (its 'e', or 'p' after a
+ * hexadecimal number, and its sign)- strtod leaves it, but fscanf can't put it back, so it is read with the
+ * number and the number keeps its value without it
+ * @param number : the beginning of the number (after the sign)
+ * @param length : the length of the number, from numberLength
+ * @param end : the end of the input
+ * @return the length of the exponent, or 0 if there is none
+ */
+size_t danglingExponentLength(const char *number, size_t length, const char *end)
+{
+    int isHex = length > 2 && number[0] == '0' && (number[1] == 'x' || number[1] == 'X');
+    const char *pos = number + length, *marker = isHex ? "pP" : "eE";
+    if (length == 0 || !(isdigit((unsigned char) number[0]) || number[0] == '.') || pos >= end ||
+        (*pos != marker[0] && *pos != marker[1]) || memchr(number, marker[0], length) != NULL ||
+        memchr(number, marker[1], length) != NULL)
+    { // no number, infinity or nan, no exponent after it or an exponent already read with its digits
+        return 0;
+    }
+    return pos + 1 < end && (pos[1] == '+' || pos[1] == '-') ? 2 : 1;
+}
+
+/**
+ * this function copies a word to a null terminated string- to the given buffer if it fits and to the heap
+ * otherwise
+ * @param word : the word
+ * @param length : the length of the word
+ * @param buffer : a buffer of WORD_BUFFER_SIZE bytes
+ * @return the string (to free if it isn't the buffer), or NULL if the memory couldn't be allocated
+ */
+char *copyWord(const char *word, size_t length, char *buffer)
+{
+    char *copy = length < WORD_BUFFER_SIZE ? buffer : (char *) malloc(length + 1);
+    if (copy != NULL)
+    {
+        memcpy(copy, word, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+/**
+ * this function converts a decimal number with a mantissa up to 2^53 and a power of ten up to 10^22 to a double
+ * with a single rounding (Clinger's fast path)
+ * @param pos : the beginning of the number (with its sign)
+ * @param end : the end of the number
+ * @param value : the double pointer to init
+ * @return 1 if it was converted and 0 if the number has to be converted by strtod
+ */
+int fastDecimalToDouble(const char *pos, const char *end, double *value)
+{
+#if FLT_EVAL_METHOD == 0
+    int isNegative = 0, power = 0, exponent = 0, isNegativeExponent = 0;
+    long long mantissa = 0;
+    if (*pos == '+' || *pos == '-')
+    {
+        isNegative = *pos++ == '-';
+    }
+    for (; pos < end && isdigit((unsigned char) *pos); ++pos)
+    {
+        if (mantissa > (FAST_MANTISSA_LIMIT - (*pos - '0')) / 10)
+        {
+            return 0;
+        }
+        mantissa = mantissa * 10 + (*pos - '0');
+    }
+    if (pos < end && *pos == '.')
+    {
+        for (++pos; pos < end && isdigit((unsigned char) *pos); ++pos, --power)
+        {
+            if (mantissa > (FAST_MANTISSA_LIMIT - (*pos - '0')) / 10)
+            {
+                return 0;
+            }
+            mantissa = mantissa * 10 + (*pos - '0');
+        }
+    }
+    if (pos < end && (*pos == 'e' || *pos == 'E'))
+    {
+        ++pos;
+        if (*pos == '+' || *pos == '-')
+        {
+            isNegativeExponent = *pos++ == '-';
+        }
+        for (; pos < end; ++pos)
+        {
+            exponent = exponent * 10 + (*pos - '0');
+            if (exponent > FAST_MAX_POWER + DBL_DIG)
+            {
+                return 0;
+            }
+        }
+        power += isNegativeExponent ? -exponent : exponent;
+    }
+    if (pos != end || power > FAST_MAX_POWER || power < -FAST_MAX_POWER)
+    { // not a decimal number (hexadecimal, infinity, nan) or out of the exact powers
+        return 0;
+    }
+    double result = power < 0 ? (double) mantissa / POWERS_OF_TEN[-power] : (double) mantissa * POWERS_OF_TEN[power];
+    *value = isNegative ? -result : result;
+    return 1;
+#else
+    (void) pos;
+    (void) end;
+    (void) value;
+    return 0; // double arithmetic may round twice
+#endif
+}
+
+/**
+ * this function reads a floating point number like "%lf" of fscanf
+ * @param input : the input
+ * @param value : the double pointer to init
+ * @return 1 if it was read and 0 otherwise
+ */
+int scanDouble(input_cursor *input, double *value)
+{
+    skipSpaces(input);
+    const char *start = input->pos, *pos = start;
+    if (pos < input->end && (*pos == '+' || *pos == '-'))
+    {
+        ++pos;
+    }
+    size_t length = numberLength(pos, input->end);
+    input->pos = pos + length + danglingExponentLength(pos, length, input->end); // with no number the sign only
+    if (length == 0)
+    {
+        return 0;
+    }
+    if (fastDecimalToDouble(start, pos + length, value) == 0)
+    {
+        *value = wordToDouble(start, (size_t) (pos + length - start));
+    }
+    return 1;
+}
+
+/**
+ * this function reads a word (up to white space) like "%s" of fscanf, without copying it
+ * @param input : the input
+ * @param word : the pointer to the beginning of the word to init
+ * @return the length of the word, or 0 at the end of the input
+ */
+size_t scanWord(input_cursor *input, const char **word)
+{
+    skipSpaces(input);
+    *word = input->pos;
+    while (input->pos < input->end && !isspace((unsigned char) *input->pos))
+    {
+        ++input->pos;
+    }
+    return (size_t) (input->pos - *word);
+}
+
+/**
+ * this function reads the rest of the line like fgets with a buffer of limit + 1 bytes
+ * @param input : the input
+ * @param line : the pointer to the beginning of the line to init
+ * @param limit : the most bytes to read
+ * @return the number of bytes read
+ */
+size_t readLinePrefix(input_cursor *input, const char **line, size_t limit)
+{
+    *line = input->pos;
+    size_t length = 0;
+    while (input->pos < input->end && length < limit)
+    {
+        ++length;
+        if (*input->pos++ == '\n')
+        {
+            break;
+        }
+    }
+    return length;
+}
+
+/**
+ * this function skips to the beginning of the next line
+ * @param input : the input
+ */
+void skipLine(input_cursor *input)
+{
+    const char *newLine = memchr(input->pos, '\n', (size_t) (input->end - input->pos));
+    input->pos = newLine != NULL ? newLine + 1 : input->end;
+}
+
+/**
+ * this function converts a word of the input to a double like strtod
+ * @param word : the word
+ * @param length : the length of the word
+ * @return the double
+ */
+double wordToDouble(const char *word, size_t length)
+{
+    char buffer[WORD_BUFFER_SIZE];
+    char *copy = copyWord(word, length, buffer);
+    double value = copy != NULL ? strtod(copy, NULL) : 0;
+    if (copy != buffer)
+    {
+        free(copy);
+    }
+    return value;
+}
@@ -0,0 +1,86 @@
+/*
+ * tokenizer.h
+ *
+ * A zero-copy reader of the input file- the file is mapped to memory and read through a cursor, with the
+ * conversions of fscanf.
+ */
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <stdlib.h>
+
+/**
+ * A cursor over the bytes of an input file.
+ */
+typedef struct
+{
+    /** the bytes of the file, the next byte to read and the end of the bytes */
+    const char *data, *pos, *end;
+    /** the size of the mapping, or 0 if the bytes were read to the heap (a pipe, an empty file) */
+    size_t mappedSize;
+} input_cursor;
+
+/**
+ * Opens the given file for reading- maps it to memory, or reads it whole if it can't be mapped. Returns 0 on
+ * success and -1 if the file couldn't be opened.
+ */
+int openInput(const char *fileName, input_cursor *input);
+
+/**
+ * Releases the bytes of an input.
+ */
+void closeInput(input_cursor *input);
+
+/**
+ * Skips white space, like a space in the format of fscanf.
+ */
+void skipSpaces(input_cursor *input);
+
+/**
+ * Skips white space and reads the given character, like a character in the format of fscanf. Returns 1 if it
+ * was read and 0 (without reading it) otherwise.
+ */
+int scanLiteral(input_cursor *input, char expected);
+
+/**
+ * Reads an int like "%d" of fscanf. Returns 1 if it was read and 0 otherwise (a sign with no digits after it
+ * is read anyway, as fscanf does).
+ */
+int scanInt(input_cursor *input, int *value);
+
+/**
+ * Reads a floating point number like "%lf" of fscanf- the number is rounded once, to the nearest double.
+ * Returns 1 if it was read and 0 otherwise.
+ */
+int scanDouble(input_cursor *input, double *value);
+
+/**
+ * Converts the decimal number from pos to end (with its sign) with a single double operation (Clinger's fast
+ * path), when its mantissa is below 2^53 and its power of ten is an exact double. Returns 1 if it was converted
+ * and 0 if it has to be converted by strtod.
+ */
+int fastDecimalToDouble(const char *pos, const char *end, double *value);
+
+/**
+ * Reads a word (up to white space) like "%s" of fscanf, without copying it. Returns its length, or 0 at the end
+ * of the input.
+ */
+size_t scanWord(input_cursor *input, const char **word);
+
+/**
+ * Reads the rest of the line like fgets with a buffer of limit + 1 bytes- up to limit bytes, ending after the
+ * new line. Returns the number of bytes read (0 at the end of the input).
+ */
+size_t readLinePrefix(input_cursor *input, const char **line, size_t limit);
+
+/**
+ * Skips to the beginning of the next line.
+ */
+void skipLine(input_cursor *input);
+
+/**
+ * Converts a word of the input to a double like strtod (the word isn't null terminated).
+ */
+double wordToDouble(const char *word, size_t length);
+
+#endif /* TOKENIZER_H */
@@ -0,0 +1,339 @@
+/**
+ * @file tokenizer_test.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * the conformance and throughput tests of the number parser of the tokenizer
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * every number is parsed by scanDouble, by the fast path (when it takes the number) and by the fallback, and
+ * all of them have to give the bits strtod gives and read the characters strtod reads (and an exponent with no
+ * digits after them, that fscanf reads and strtod leaves). the numbers are the
+ * round trips of random doubles, subnormals, mantissas longer than a double holds, the edges of the exponent and
+ * the other forms strtod reads. then the throughput of scanDouble is measured against strtod on a large text.
+ * Input  : none
+ * Process: parse the numbers and compare them with strtod
+ * Output : the failed numbers and the throughput, and the exit code 0 if all the numbers passed
+ */
+
+// ------------------------------ includes ------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <ctype.h>
+#include <time.h>
+#include "tokenizer.h"
+
+// -------------------------- const definitions -------------------------
+
+/**
+ * the number of random doubles of the round trip cases
+ */
+#define ROUND_TRIPS 200000
+
+/**
+ * the number of numbers in the text of the throughput test
+ */
+#define THROUGHPUT_NUMBERS 1000000
+
+/**
+ * the longest text of a number in the tests
+ */
+#define NUMBER_TEXT_SIZE 512
+
+/**
+ * @brief the counts of the tests
+ */
+typedef struct
+{
+    unsigned long cases, failed, fastPath;
+} test_counts;
+
+/**
+ * the numbers with a subnormal or nearly subnormal value
+ */
+static const char *SUBNORMAL_CASES[] = {
+        "4.9406564584124654e-324", "5e-324", "2.4703282292062327e-324", "2.4703282292062328e-324", "1e-320",
+        "-1e-320", "2.2250738585072009e-308", "2.2250738585072011e-308", "2.2250738585072012e-308",
+        "2.2250738585072014e-308", "4.9406564584124654417656879286822137236505980e-324", "1e-330", "0.0e-400",
+        "3e-324", "7.4109846876186982e-324", NULL};
+
+/**
+ * the numbers with more digits than the mantissa of a double holds
+ */
+static const char *LONG_MANTISSA_CASES[] = {
+        "9007199254740992", "9007199254740993", "9007199254740994", "9007199254740995", "18014398509481985",
+        "123456789012345678901234567890", "0.1000000000000000055511151231257827021181583404541015625",
+        "0.30000000000000004", "3.14159265358979323846264338327950288419716939937510", "999999999999999999999",
+        "1.00000000000000011102230246251565404236316680908203125",
+        "1.00000000000000011102230246251565404236316680908203124",
+        "1.00000000000000011102230246251565404236316680908203126", "00000000000000000000000000000001.5",
+        "0.000000000000000000000000000000000000000000000000000000000000000000000000000001", "-4503599627370497.5",
+        "179769313486231580793728971405303415079934132710037826936173778980444968292764750946649017977587207096330"
+        "286416692887910946555547851940402630657488671505820681908902000708383676273854845817711531764475730270069"
+        "855571366959622842914819860834936475292719074168444365510704342711559699508093042880177904174497791.9999",
+        NULL};
+
+/**
+ * the numbers on the edges of the exponent and of the fast path
+ */
+static const char *EXPONENT_CASES[] = {
+        "1e22", "1e23", "1e-22", "1e-23", "9007199254740991e22", "9007199254740991e-22", "9007199254740993e22",
+        "1e308", "1.7976931348623157e308", "1.7976931348623158e308", "1.7976931348623159e308", "1e309", "1e400",
+        "-1e400", "1e-400", "1e+0", "1E5", "1e0000000000000000000000022", "1e-0000000000000000000000022",
+        "123e-2", "0.00000000000000000000001e45", "1e99999999999999999999", "1e-99999999999999999999",
+        "12345678901234.5e8", "1e", "1e+", "1e-", "1ex", "1.e", "-.5E+,", "5e5e", "5e5e+", "0x1p", "0x1P-",
+        "0x1ep", "infe", NULL};
+
+/**
+ * the other forms strtod reads, and words it doesn't
+ */
+static const char *FORM_CASES[] = {
+        "0", "-0", "+0", "-0.0", ".5", "+.5", "-.5", "5.", "-5.", "  \t42", "0x1p-3", "0X1.8P+1", "-0x.8p1",
+        "0x", "0x.", "0xg", "inf", "-INF", "Infinity", "infinit", "nan", "-NaN", "nan(123)", "nan(", "1.5,",
+        "2.5e3,7", ".", "-", "+", "e5", "", "1..2", "0.1.2", NULL};
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function tells if two doubles are the same- the same bits, or both NaN
+ * @param a : the first double
+ * @param b : the second double
+ * @return 1 if they are the same and 0 otherwise
+ */
+int isSameDouble(double a, double b)
+{
+    if (a != a || b != b)
+    {
+        return a != a && b != b;
+    }
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+/**
+ * this function finds the length of the exponent with no digits that fscanf reads after the number strtod read
+ * @param number : the beginning of the number (after the spaces)
+ * @param numberEnd : the end of the number strtod read
+ * @return the length of the exponent- its letter and its sign- or 0 if there is none
+ */
+size_t danglingExponent(const char *number, const char *numberEnd)
+{
+    const char *digits = number + (*number == '+' || *number == '-');
+    int isHex = digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X');
+    const char *letters = isHex ? "pP" : "eE", *pos;
+    if (!isdigit((unsigned char) *digits) && *digits != '.')
+    { // infinity or nan
+        return 0;
+    }
+    for (pos = digits; pos < numberEnd; ++pos)
+    {
+        if (*pos == letters[0] || *pos == letters[1])
+        { // the number has its exponent
+            return 0;
+        }
+    }
+    if (*numberEnd != letters[0] && *numberEnd != letters[1])
+    {
+        return 0;
+    }
+    return numberEnd[1] == '+' || numberEnd[1] == '-' ? 2 : 1;
+}
+
+/**
+ * this function parses a number with scanDouble, the fast path and the fallback and compares them with strtod
+ * @param group : the name of the cases of the number
+ * @param text : the text of the number
+ * @param counts : the counts of the tests
+ */
+void checkNumber(const char *group, const char *text, test_counts *counts)
+{
+    char *referenceEnd;
+    double reference = strtod(text, &referenceEnd), value = 0, fast = 0;
+    size_t consumed = (size_t) (referenceEnd - text);
+    input_cursor input = {text, text, text + strlen(text), 0};
+    int isRead = scanDouble(&input, &value);
+    int isPassed = isRead == (consumed > 0);
+    const char *number = text;
+    while (*number == ' ' || *number == '\t')
+    {
+        ++number;
+    }
+    if (isRead && consumed > 0)
+    {
+        size_t length = (size_t) (referenceEnd - number);
+        consumed += danglingExponent(number, referenceEnd);
+        isPassed = isPassed && (size_t) (input.pos - text) == consumed && isSameDouble(value, reference) &&
+                   isSameDouble(wordToDouble(number, length), reference);
+        if (fastDecimalToDouble(number, referenceEnd, &fast))
+        {
+            ++counts->fastPath;
+            isPassed = isPassed && isSameDouble(fast, reference);
+        }
+    }
+    ++counts->cases;
+    if (!isPassed)
+    {
+        ++counts->failed;
+        printf("FAIL %s \"%s\": strtod %a (%zu characters), scanDouble %a (%zu characters, %s), fast path %a\n",
+               group, text, reference, consumed, value, (size_t) (input.pos - text), isRead ? "read" : "not read",
+               fast);
+    }
+}
+
+/**
+ * this function checks all the numbers of a list of cases
+ * @param group : the name of the cases
+ * @param cases : the numbers, ending with NULL
+ * @param counts : the counts of the tests
+ */
+void checkCases(const char *group, const char **cases, test_counts *counts)
+{
+    size_t i;
+    for (i = 0; cases[i] != NULL; ++i)
+    {
+        checkNumber(group, cases[i], counts);
+    }
+}
+
+/**
+ * this function gives the next number of a xorshift generator, so the random cases are the same in every run
+ * @param state : the state of the generator (not zero)
+ * @return the next 64 random bits
+ */
+uint64_t nextRandom(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/**
+ * this function gives a random finite double- random bits, so all the exponents are as likely
+ * @param state : the state of the generator
+ * @return the double
+ */
+double randomDouble(uint64_t *state)
+{
+    double value;
+    do
+    {
+        uint64_t bits = nextRandom(state);
+        memcpy(&value, &bits, sizeof(double));
+    } while (value != value || value - value != 0);
+    return value;
+}
+
+/**
+ * this function checks the round trips of random doubles- printed with 17 digits (which must give back the
+ * same double), with 15 digits (the fast path, for the small exponents) and in the format of the inputs
+ * @param counts : the counts of the tests
+ */
+void checkRoundTrips(test_counts *counts)
+{
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    char text[NUMBER_TEXT_SIZE];
+    unsigned long i;
+    for (i = 0; i < ROUND_TRIPS; ++i)
+    {
+        double value = randomDouble(&state);
+        snprintf(text, sizeof(text), "%.17g", value);
+        double parsed = 0;
+        input_cursor input = {text, text, text + strlen(text), 0};
+        if (!scanDouble(&input, &parsed) || !isSameDouble(parsed, value))
+        {
+            ++counts->failed;
+            printf("FAIL round trip \"%s\": expected %a, scanDouble %a\n", text, value, parsed);
+        }
+        ++counts->cases;
+        double small = (double) (int64_t) (nextRandom(&state) % 2000000001) / 10000 - 100000;
+        snprintf(text, sizeof(text), "%.15g", small * 1e-8);
+        checkNumber("round trip", text, counts);
+        snprintf(text, sizeof(text), "%.4f", small);
+        checkNumber("round trip", text, counts);
+    }
+}
+
+/**
+ * this function gives the time in seconds of a monotonic clock
+ * @return the time
+ */
+double testSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+/**
+ * this function measures the throughput of scanDouble and of strtod on a text of numbers like the ones of the
+ * inputs (most of them short decimals, some printed with 17 digits)
+ * @param counts : the counts of the tests (a different sum of the two parsers fails)
+ */
+void measureThroughput(test_counts *counts)
+{
+    char *text = (char *) malloc((size_t) THROUGHPUT_NUMBERS * 32);
+    if (text == NULL)
+    {
+        printf("throughput: skipped, the memory couldn't be allocated\n");
+        return;
+    }
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    size_t length = 0;
+    unsigned long i;
+    for (i = 0; i < THROUGHPUT_NUMBERS; ++i)
+    {
+        double value = (double) (int64_t) (nextRandom(&state) % 2000001) / 100 - 10000;
+        length += (size_t) sprintf(text + length, i % 8 == 7 ? "%.17g\n" : "%.4f\n", value / 3);
+    }
+    input_cursor input = {text, text, text + length, 0};
+    double value, scanSum = 0, strtodSum = 0;
+    double start = testSeconds();
+    while (scanDouble(&input, &value))
+    {
+        scanSum += value;
+    }
+    double scanSeconds = testSeconds() - start;
+    char *pos = text;
+    start = testSeconds();
+    for (i = 0; i < THROUGHPUT_NUMBERS; ++i)
+    {
+        strtodSum += strtod(pos, &pos);
+    }
+    double strtodSeconds = testSeconds() - start;
+    ++counts->cases;
+    if (!isSameDouble(scanSum, strtodSum))
+    {
+        ++counts->failed;
+        printf("FAIL throughput: the sum of scanDouble is %a and of strtod %a\n", scanSum, strtodSum);
+    }
+    printf("throughput of %d numbers (%.1f MB): scanDouble %.1f MB/s (%.1f M numbers/s), strtod %.1f MB/s "
+           "(%.1f M numbers/s)\n", THROUGHPUT_NUMBERS, length / 1e6, length / 1e6 / scanSeconds,
+           THROUGHPUT_NUMBERS / 1e6 / scanSeconds, length / 1e6 / strtodSeconds,
+           THROUGHPUT_NUMBERS / 1e6 / strtodSeconds);
+    free(text);
+}
+
+/**
+ * this function runs the tests of the number parser
+ * @return 0 if all the tests passed and 1 otherwise
+ */
+int main(void)
+{
+    test_counts counts = {0, 0, 0};
+    checkCases("subnormal", SUBNORMAL_CASES, &counts);
+    checkCases("long mantissa", LONG_MANTISSA_CASES, &counts);
+    checkCases("exponent", EXPONENT_CASES, &counts);
+    checkCases("form", FORM_CASES, &counts);
+    checkRoundTrips(&counts);
+    measureThroughput(&counts);
+    printf("tokenizer_test: %lu cases (%lu through the fast path), %lu failed\n", counts.cases, counts.fastPath,
+           counts.failed);
+    return counts.failed == 0 ? 0 : 1;
+}
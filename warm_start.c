@@ -0,0 +1,155 @@
+/**
+ * @file warm_start.c
+ * @author  Zohar Bouchnik <zohar.bouchnik@mail.huji.ac.il>
+ * @version 1.0
+ * @date 19 aug 2018
+ *
+ * @brief
+ * loads the last round of a former run, to start a calculation from it
+ *
+ * @section LICENSE
+ * none
+ *
+ * @section DESCRIPTION
+ * a calculation whose source points changed a little reaches its steady state much sooner from the steady state
+ * of the former run than from a grid of zeros. the former run is read from its output- a file of binary snapshots
+ * (told by its first bytes) or the text output, and only its last round is used.
+ * the binary snapshots are walked by their headers; a snapshot cut at the end of the file (a run that was
+ * stopped) is ignored. the last round of the text output is its last n + 1 lines- the result and the rows.
+ * Input  : the output of a former run
+ * Process: find its last round and check it is a round of the grid
+ * Output : the cells of the round
+ */
+
+// ------------------------------ includes ------------------------------
+#include <string.h>
+#include <stddef.h>
+#include "warm_start.h"
+#include "tokenizer.h"
+#include "output.h"
+#include "binary_input.h"
+
+// ------------------------------ functions -----------------------------
+
+/**
+ * this function loads the last complete snapshot of a file of binary snapshots
+ * @param input : the input of the file
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param cells : the n * m cells to load
+ * @return 0 on success and -2 if the file isn't snapshots of an n x m grid
+ */
+int loadRawSnapshot(const input_cursor *input, size_t n, size_t m, double *cells)
+{
+    const unsigned char *pos = (const unsigned char *) input->pos, *end = (const unsigned char *) input->end;
+    const unsigned char *last = NULL;
+    size_t size = n * m * sizeof(double), i;
+    while ((size_t) (end - pos) >= sizeof(snapshot_header))
+    {
+        if (memcmp(pos, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LENGTH) != 0 ||
+            loadLittleEndian(pos + offsetof(snapshot_header, rows), sizeof(uint64_t)) != n ||
+            loadLittleEndian(pos + offsetof(snapshot_header, cols), sizeof(uint64_t)) != m)
+        {
+            return -2;
+        }
+        if ((size_t) (end - pos) - sizeof(snapshot_header) < size)
+        { // cut by a stopped run
+            break;
+        }
+        last = pos + sizeof(snapshot_header);
+        pos = last + size;
+    }
+    if (last == NULL)
+    {
+        return -2;
+    }
+    for (i = 0; i < n * m; ++i)
+    {
+        cells[i] = loadDouble(last + i * sizeof(double));
+    }
+    return 0;
+}
+
+/**
+ * this function loads the last round of the text output- the result line and n lines of m cells, every cell
+ * followed by a comma
+ * @param input : the input of the file
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param cells : the n * m cells to load
+ * @return 0 on success and -2 if the file isn't an output of an n x m grid
+ */
+int loadCsvSnapshot(const input_cursor *input, size_t n, size_t m, double *cells)
+{
+    const char *end = input->end, *start;
+    size_t newLines = 0, row, col;
+    while (end > input->pos && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' '))
+    {
+        --end;
+    }
+    for (start = end; start > input->pos; --start)
+    { // back to the beginning of the result line of the last round
+        if (start[-1] == '\n' && ++newLines == n + 1)
+        {
+            break;
+        }
+    }
+    if (newLines < n)
+    {
+        return -2;
+    }
+    input_cursor round = {input->data, start, end, 0};
+    double result;
+    if (!scanDouble(&round, &result))
+    {
+        return -2;
+    }
+    for (row = 0; row < n; ++row)
+    {
+        for (col = 0; col < m; ++col)
+        {
+            if (!scanDouble(&round, &cells[row * m + col]) || !scanLiteral(&round, ','))
+            {
+                return -2;
+            }
+        }
+        if (round.pos < round.end && *round.pos != '\n' && *round.pos != '\r')
+        { // a longer row
+            return -2;
+        }
+    }
+    return 0;
+}
+
+/**
+ * this function loads the last round of the given output of the program
+ * @param fileName : the name of the output file
+ * @param n : the number of rows in the grid
+ * @param m : the number of columns in the grid
+ * @param cells : the pointer for the new array of the n * m cells
+ * @return 0 on success, -1 if the file couldn't be opened, -2 if it isn't an output of an n x m grid and -3 if
+ * the memory couldn't be allocated
+ */
+int loadWarmStart(const char *fileName, size_t n, size_t m, double **cells)
+{
+    input_cursor input;
+    if (openInput(fileName, &input) != 0)
+    {
+        return -1;
+    }
+    int status = -3;
+    *cells = (double *) malloc(n * m * sizeof(double));
+    if (*cells != NULL)
+    {
+        size_t size = (size_t) (input.end - input.pos);
+        status = size >= SNAPSHOT_MAGIC_LENGTH && memcmp(input.pos, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LENGTH) == 0
+                 ? loadRawSnapshot(&input, n, m, *cells) : loadCsvSnapshot(&input, n, m, *cells);
+        if (status != 0)
+        {
+            free(*cells);
+            *cells = NULL;
+        }
+    }
+    closeInput(&input);
+    return status;
+}
@@ -0,0 +1,18 @@
+/*
+ * warm_start.h
+ *
+ * Loads the grid of a former run, to start a calculation from it instead of from a grid of zeros.
+ */
+#ifndef WARM_START_H
+#define WARM_START_H
+
+#include <stdlib.h>
+
+/**
+ * Loads the last round of the given output of the program- the text output or a file of binary snapshots- to
+ * a new array of n * m cells in row major order. Returns 0 on success, -1 if the file couldn't be opened, -2
+ * if it isn't an output of an n x m grid and -3 if the memory couldn't be allocated.
+ */
+int loadWarmStart(const char *fileName, size_t n, size_t m, double **cells);
+
+#endif /* WARM_START_H */